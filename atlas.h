@@ -0,0 +1,158 @@
+/**
+ * Header file responsible for packing sprites into texture atlas pages
+ *
+ * Every sprite is given an identifier as it is added, and once all have been added they are packed together into as
+ * few square pages as possible, tallest first, by splitting each page's free space into rectangles (a guillotine
+ * packer). Each sprite keeps a one pixel transparent gutter around it, so that filtering at its edges samples
+ * transparency, exactly as it would at the clamped edges of a texture of its own.
+ * Nothing here depends on GL - the pages are plain RGBA pixels, ready to be uploaded as textures.
+ */
+
+#ifndef PACMAN_ATLAS_H
+#define PACMAN_ATLAS_H
+
+const int ATLAS_PAGE_SIZE = 1024;   // Width and height of each page, in pixels
+const int ATLAS_GUTTER = 1;         // Transparent border kept around every sprite, in pixels
+
+// Location of a sprite within the atlas
+struct AtlasSprite
+{
+    int page;               // Page holding the sprite
+    int x, y;               // Bottom left corner of the sprite within its page, in pixels
+    int width, height;      // Size of the sprite, in pixels
+    float u0, v0, u1, v1;   // Texture coordinates of the sprite's bottom left and top right corners
+};
+
+// A free rectangle of a page, into which sprites may yet be packed
+struct AtlasSpace
+{
+    int page;
+    int x, y;
+    int width, height;
+};
+
+struct Atlas
+{
+    vector<AtlasSprite> sprites;            // Every sprite added, indexed by identifier
+    int pageCount;                          // Number of pages the sprites were packed into
+    vector<vector<unsigned char> > pages;   // RGBA pixels of every page, row by row from the bottom, once allocated
+
+    Atlas()
+    {
+        pageCount = 0;
+    }
+};
+
+/**
+ * Add a sprite of a given size to the atlas, to be placed by packAtlas()
+ *
+ * @param atlas -  atlas to add to
+ * @param width -  width of the sprite, in pixels
+ * @param height - height of the sprite, in pixels
+ * @return -       identifier of the sprite, or -1 if it is too large to fit on a page
+ */
+int addSprite(Atlas& atlas, int width, int height)
+{
+    if(width + 2 * ATLAS_GUTTER > ATLAS_PAGE_SIZE || height + 2 * ATLAS_GUTTER > ATLAS_PAGE_SIZE)
+        return -1;
+
+    AtlasSprite sprite = {};
+    sprite.width = width;
+    sprite.height = height;
+    atlas.sprites.push_back(sprite);
+    return atlas.sprites.size() - 1;
+}
+
+/**
+ * Place every sprite added to the atlas, counting the pages needed
+ *
+ * @param atlas - atlas to pack
+ */
+void packAtlas(Atlas& atlas)
+{
+    // Pack the tallest sprites first, as they leave the most usable space beside them
+    vector<int> order(atlas.sprites.size());
+    for(size_t i = 0; i < order.size(); i++)
+        order[i] = i;
+    stable_sort(order.begin(), order.end(), [&atlas](int a, int b)
+    {
+        return atlas.sprites[a].height > atlas.sprites[b].height;
+    });
+
+    vector<AtlasSpace> spaces;
+    int pageCount = 0;
+    for(size_t i = 0; i < order.size(); i++)
+    {
+        AtlasSprite& sprite = atlas.sprites[order[i]];
+        int width = sprite.width + 2 * ATLAS_GUTTER;
+        int height = sprite.height + 2 * ATLAS_GUTTER;
+
+        // Find the free rectangle that the sprite fits most snugly, opening a new page if none fit
+        int best = -1;
+        for(size_t s = 0; s < spaces.size(); s++)
+        {
+            if(spaces[s].width >= width && spaces[s].height >= height &&
+               (best == -1 || spaces[s].width * spaces[s].height < spaces[best].width * spaces[best].height))
+                best = s;
+        }
+        if(best == -1)
+        {
+            AtlasSpace page = {pageCount++, 0, 0, ATLAS_PAGE_SIZE, ATLAS_PAGE_SIZE};
+            spaces.push_back(page);
+            best = spaces.size() - 1;
+        }
+
+        AtlasSpace space = spaces[best];
+        spaces.erase(spaces.begin() + best);
+        sprite.page = space.page;
+        sprite.x = space.x + ATLAS_GUTTER;
+        sprite.y = space.y + ATLAS_GUTTER;
+        sprite.u0 = (float)sprite.x / ATLAS_PAGE_SIZE;
+        sprite.v0 = (float)sprite.y / ATLAS_PAGE_SIZE;
+        sprite.u1 = (float)(sprite.x + sprite.width) / ATLAS_PAGE_SIZE;
+        sprite.v1 = (float)(sprite.y + sprite.height) / ATLAS_PAGE_SIZE;
+
+        // Split what is left of the rectangle in two, along whichever side leaves the larger piece whole
+        int right = space.width - width;
+        int above = space.height - height;
+        AtlasSpace rightSpace = {space.page, space.x + width, space.y, right, right > above ? space.height : height};
+        AtlasSpace aboveSpace = {space.page, space.x, space.y + height, right > above ? width : space.width, above};
+        if(rightSpace.width > 0 && rightSpace.height > 0)
+            spaces.push_back(rightSpace);
+        if(aboveSpace.width > 0 && aboveSpace.height > 0)
+            spaces.push_back(aboveSpace);
+    }
+
+    atlas.pageCount = pageCount;
+}
+
+/**
+ * Allocate cleared pixels for every page of a packed atlas, for sprites to be copied into
+ *
+ * @param atlas - packed atlas
+ */
+void allocatePages(Atlas& atlas)
+{
+    atlas.pages.assign(atlas.pageCount, vector<unsigned char>((size_t)ATLAS_PAGE_SIZE * ATLAS_PAGE_SIZE * 4, 0));
+}
+
+/**
+ * Copy a sprite's pixels into its place in the packed atlas
+ *
+ * @param atlas -  packed atlas, with its pages allocated
+ * @param id -     identifier of the sprite
+ * @param pixels - RGBA pixels of the sprite, row by row from the bottom, each row padded to a multiple of 4 bytes
+ */
+void copySprite(Atlas& atlas, int id, const char* pixels)
+{
+    const AtlasSprite& sprite = atlas.sprites[id];
+    vector<unsigned char>& page = atlas.pages[sprite.page];
+    int rowBytes = sprite.width * 4;    // RGBA rows are always a multiple of 4 bytes, so need no padding
+    for(int row = 0; row < sprite.height; row++)
+    {
+        memcpy(&page[((size_t)(sprite.y + row) * ATLAS_PAGE_SIZE + sprite.x) * 4], pixels + (size_t)row * rowBytes,
+               rowBytes);
+    }
+}
+
+#endif //PACMAN_ATLAS_H
@@ -5,13 +5,8 @@
 #ifndef PACMAN_GHOSTS_H
 #define PACMAN_GHOSTS_H
 
-// Allow access of ticks, eaten ghost count and Pac-Man from globals.h
-extern int ticks;
-extern int ghostsEaten;
-extern Pacman pacman;
-
-// Ghost AI targeting is wave-based, varying between CHASE and SCATTER over time
-movement wave = SCATTER;
+// X position of the center of the SPAWN pen, in sub-tile units - halfway between tiles 13 and 14
+const int PEN_X = 13 * SUB_TILE + SUB_TILE / 2;
 
 /**
  * For ease of reference and handling ghosts, they are defined as an object type
@@ -22,11 +17,11 @@ class Ghost
 {
 private:
     /// List of private variables which ghost uses
-    float x;        // X position relative to map - float allows for smooth movement between tiles
-    float x_init;   // Initial X position stored for later resets
-    float y;        // Y position relative to map - float allows for smooth movement between tiles
-    float y_init;   // Initial X position stored for later resets
-    float d_pos;    // Delta position - the amount the ghost should move each tick
+    int x;          // X position relative to map, in sub-tile units - allows for smooth movement between tiles
+    int x_init;     // Initial X position stored for later resets
+    int y;          // Y position relative to map, in sub-tile units - allows for smooth movement between tiles
+    int y_init;     // Initial X position stored for later resets
+    int d_pos;      // Delta position - the amount, in sub-tile units, the ghost should move each tick
     color colour;   // Colour of ghost
     direction dir;  // Direction of movement
     int tex_count;  // Counter to determine which texture to draw
@@ -34,19 +29,22 @@ private:
     bool reverse;   // Flag determining whether to reverse the ghost
     int timeout;    // Timeout used to determine when to leave FRIGHTENED mode AI, -1 = default
     bool drawScore; // Flag determining whether to draw the score for eating this ghost
+    bool pathTargeting; // Flag determining whether to target tiles by path distance rather than straight line distance
 
 public:
     /**
      * Constructor & Reset methods initialise all variables to starting state
+     * Starting position is given in tiles, and converted to sub-tile units
      */
     Ghost(float x, float y, color c)
     {
-        this->x = x;
-        x_init = x;
-        this->y = y;
-        y_init = y;
-        d_pos = 0.1f;
+        this->x = (int)(x * SUB_TILE);
+        x_init = this->x;
+        this->y = (int)(y * SUB_TILE);
+        y_init = this->y;
+        d_pos = SUB_TILE / 10;
         colour = c;
+        pathTargeting = false;
         tex_count = 0;
         reverse = false;
         timeout = -1;
@@ -57,7 +55,7 @@ public:
         {
             case RED:
                 dir = LEFT;
-                ai = wave;      // RED starts outside the pen and is immediately in the first targeting mode defined by wave
+                ai = SCATTER;   // RED starts outside the pen and is immediately in the first targeting wave, SCATTER
                 break;
             case PINK:
                 dir = DOWN;
@@ -70,11 +68,11 @@ public:
                 break;
         }
     }
-    void reset()
+    void reset(movement wave)
     {
         x = x_init;
         y = y_init;
-        d_pos = 0.1f;
+        d_pos = SUB_TILE / 10;
         tex_count = 0;
         reverse = false;
         timeout = -1;
@@ -104,9 +102,9 @@ public:
      *
      * @return - integer, X coordinate of current tile
      */
-    int getX()
+    int getX() const
     {
-        return round(x);
+        return toTile(x);
     }
 
     /**
@@ -114,71 +112,39 @@ public:
      *
      * @return - integer, Y coordinate of current tile
      */
-    int getY()
+    int getY() const
     {
-        return round(y);
+        return toTile(y);
     }
 
     /**
-     * Determines and returns the next tile in the given direction of movement
-     *
-     * @param d - direction of movement in which to check to the next tile
-     * @return -  next tile in direction d
+     * @return - the ghost's exact position, in sub-tile units
      */
-    tile getNextTile(direction d)
+    Point getPosition() const
     {
-        // Return next tile in given direction
-        switch(d)
-        {
-            case UP:
-                return getTile(getX(),getY() + 1);
-            case RIGHT:
-                return getTile(getX() + 1,getY());
-            case DOWN:
-                return getTile(getX(),getY() - 1);
-            case LEFT:
-                return getTile(getX() - 1,getY());
-        }
+        return {x, y};
     }
 
     /**
-     * Determines whether ghost is currently at the center of a tile
-     * Expression basically validates that the first decimal point of each coordinate is a zero
-     * If each is a zero, ghost is at the center of his tile
+     * Get the exit flags of the tile on which the ghost resides
      *
-     * @return - boolean, true if at center
+     * @return - exit flags of the current tile
      */
-    bool atTileCenter()
+    uint8_t currentExits()
     {
-        int mod = 1/d_pos;
-        return (int)round(y * mod) % mod == 0 && (int)round(x * mod) % mod == 0;
+        return getExits(getX(),getY());
     }
 
     /**
-     * Count the number of exits from the current position
-     * If the ghost is not at the tile center, exits=0
-     * If the ghost is at the tile center, exit count can determine what kind of junction the ghost is at
-     *      2 Exits: Straight/Corner (corner requires && isImpassible(getNextTile(dir)) to confirm)
-     *      3 Exits: T-Junction
-     *      4 Exits: X-Intersection
+     * Determines whether ghost is currently at the center of a tile
+     * If each coordinate is a whole number of tiles, ghost is at the center of his tile
+     * Exact at every speed, as positions are always kept to a multiple of d_pos (see roundPosition)
      *
-     * @return integer number of exits from the current position
+     * @return - boolean, true if at center
      */
-    int countExits()
+    bool atTileCenter()
     {
-        int exits = 0;
-        if(atTileCenter())
-        {
-            if(!isImpassible(getNextTile(UP)))
-                exits++;
-            if(!isImpassible(getNextTile(RIGHT)))
-                exits++;
-            if(!isImpassible(getNextTile(DOWN)))
-                exits++;
-            if(!isImpassible(getNextTile(LEFT)))
-                exits++;
-        }
-        return exits;
+        return y % SUB_TILE == 0 && x % SUB_TILE == 0;
     }
 
     /**
@@ -186,13 +152,14 @@ public:
      */
     void turnCorner()
     {
-        if(dir != DOWN && !isImpassible(getNextTile(UP)))
+        uint8_t exits = currentExits();
+        if(dir != DOWN && (exits & EXIT_UP))
             dir = UP;
-        else if(dir != LEFT && !isImpassible(getNextTile(RIGHT)))
+        else if(dir != LEFT && (exits & EXIT_RIGHT))
             dir = RIGHT;
-        else if(dir != UP && !isImpassible(getNextTile(DOWN)))
+        else if(dir != UP && (exits & EXIT_DOWN))
             dir = DOWN;
-        else if(dir != RIGHT && !isImpassible(getNextTile(LEFT)))
+        else if(dir != RIGHT && (exits & EXIT_LEFT))
             dir = LEFT;
     }
 
@@ -249,6 +216,8 @@ public:
      */
     void setAI(movement newAI, bool switchDir)
     {
+        TRACE_EVENT_VALUE(TRACE_AI_NAMES[newAI], colour);    // Traced with the ghost's colour
+
         ai = newAI;
         reverse = switchDir;
 
@@ -268,27 +237,27 @@ public:
      * When setting the speed of a ghost, it is necessary to round the ghost's coordinates to the correct degree of precision
      *
      * Rounding prevents errors such as being unable to recognise the center of a tile or overshooting a junction when changing speeds
-     *      EXAMPLE CASE:   Ghost is travelling at 50% speed (FRIGHTENED) so increases position by 0.05 each tick
-     *                      Upon death, its speed is incremented to 200%, moving by 0.2 tiles each tick
+     *      EXAMPLE CASE:   Ghost is travelling at 50% speed so increases position by 5 units (0.05 tiles) each tick
+     *                      Upon death, its speed is incremented to 200%, moving by 20 units (0.2 tiles) each tick
      *                      Suppose the ghost was eaten at x=12.05 - possible when moving at 50% speed
-     *                      Its position will now be unable to round to x=12.0 to ascertain it is at the center of a tile
+     *                      Its position will now never land on x=12.0 to ascertain it is at the center of a tile
      *
-     * Because of cases like the above, position rounding is necessary when changing speeds
+     * Because of cases like the above, position rounding (to the nearest multiple of d_pos) is necessary when changing speeds
      */
     void roundPosition()
     {
-        x = round(x / d_pos) * d_pos;
-        y = round(y / d_pos) * d_pos;
+        x = (x + d_pos / 2) / d_pos * d_pos;
+        y = (y + d_pos / 2) / d_pos * d_pos;
     }
 
     /**
      * Set the speed of the ghost and round the position to account for movement precision inaccuracies
      *
-     * @param percentage - Float representing speed. 100% sets d_pos=0.1f (normal playing speed)
+     * @param percentage - Integer representing speed. 100% sets d_pos to 10% of a tile (normal playing speed)
      */
-    void setSpeed(float percentage)
+    void setSpeed(int percentage)
     {
-        d_pos = percentage / 1000;
+        d_pos = percentage * SUB_TILE / 1000;
         roundPosition();
     }
 
@@ -299,7 +268,7 @@ public:
     void aiSpawn()
     {
         setSpeed(50);   // Set movement speed to 50%
-        if((int)(y * 10.0f) % 10 == 5 && (int)(x * 10.0f) % 10 == 5 && isImpassible(getNextTile(dir)))
+        if(y % SUB_TILE / 10 == 5 && x % SUB_TILE / 10 == 5 && !canExit(currentExits(),dir))
         {
             switch(dir) // Switch direction upon hitting a WALL
             {
@@ -319,44 +288,74 @@ public:
      *      Once at center of pen, head up until exited PEN
      *      Immediately head LEFT and set speed to 100%
      *      Once the first tile center is reached, enter AI of current wave
+     *
+     * @param wave - current AI wave, entered once out of the pen
      */
-    void aiLeave()
+    void aiLeave(movement wave)
     {
-        if(y < 19 && dir != DOWN)
+        if(y < 19 * SUB_TILE && dir != DOWN)
         {
-            setSpeed(50);   // Set movement speed to 50%
-            if(x < 13.4)    // Move towards the center
+            setSpeed(50);           // Set movement speed to 50%
+            if(x < PEN_X - 10)      // Move towards the center
                 dir = RIGHT;
-            else if(x > 13.6)
+            else if(x > PEN_X + 10)
                 dir = LEFT;
             else
             {
-                x = 13.5;   // Truly center position when center of pen is reached
-                dir = UP;   // Then set direction to move out of the SPAWN
+                x = PEN_X;          // Truly center position when center of pen is reached
+                dir = UP;           // Then set direction to move out of the SPAWN
             }
         }
-        else if(y >= 19)    // Once out of the SPAWN, act as a normal ghost
+        else if(y >= 19 * SUB_TILE) // Once out of the SPAWN, act as a normal ghost
         {
             dir = LEFT;     // Begin heading LEFT
             ai = wave;      // Enter the current AI wave
             setSpeed(100);  // Ensure speed is correctly set to 100%
         }
-        else if((int)(y * 10.0f) % 10 == 5 && isImpassible(getNextTile(dir)))
+        else if(y % SUB_TILE / 10 == 5 && !canExit(currentExits(),dir))
             dir = UP;
     }
 
     /**
-     * Calculate and return the straight line distance between two points (tiles) in the map
+     * Calculate and return the squared straight line distance between two points (tiles) in the map
+     * Squared distances compare in the same order as the distances themselves, so no square root is needed
+     *
+     * @param p1 - x,y map coordinates of the first point
+     * @param p2 - x,y map coordinates of the second point
+     * @return -   Squared straight line distance between p1 and p2
+     */
+    int distanceSquared(Point p1, Point p2)
+    {
+        int d_x = p1.x - p2.x;
+        int d_y = p1.y - p2.y;
+        return (d_x * d_x) + (d_y * d_y);   // Simple pythagorean calculation
+    }
+
+    /**
+     * Set whether the ghost targets tiles by their path distance through the maze, rather than straight line distance
+     * Kept across resets, as an option for the whole game
      *
-     * @param p1 - Vector storing the x,y map coordinates of the first point
-     * @param p2 - Vector storing the x,y map coordinates of the second point
-     * @return -   Straight line distance between p1 and p2, floating point precision
+     * @param enabled - true to target by path distance
      */
-    float distanceBetween(vector<int> p1, vector<int> p2)
+    void setPathTargeting(bool enabled)
     {
-        float d_x = p1[0] - p2[0];
-        float d_y = p1[1] - p2[1];
-        return sqrt((d_x * d_x) + (d_y * d_y)); // Simple pythagorean calculation
+        pathTargeting = enabled;
+    }
+
+    /**
+     * Calculate the distance from a tile to a target tile, by which the ghost compares the exits of a junction
+     *
+     * @param p -      x,y map coordinates of the tile
+     * @param target - x,y map coordinates of the target tile
+     * @param byPath - true to measure path distance through the maze, false for squared straight line distance
+     * @return -       distance from p to target, INT_MAX if measuring by path and there is none
+     */
+    int targetDistance(Point p, Point target, bool byPath)
+    {
+        if(!byPath)
+            return distanceSquared(p, target);
+        int distance = mazeDistance({(p.x + 28) % 28, p.y}, target);   // Wrap through the portals, as stepFrom() does
+        return distance == NO_PATH ? INT_MAX : distance;                // Never prefer a tile with no path to the target
     }
 
     /**
@@ -366,37 +365,41 @@ public:
      *
      * Note: this does not always give the shortest PATH to the target
      *      However, this behaviour is as the original Pac-Man was designed
+     *      With path targeting enabled, path distance is used instead, giving the shortest path to any target within
+     *      the maze - targets outside the maze or inside walls (such as SCATTER points) still use straight line distance
      *
-     * @param target - Vector storing the x,y map coordinates of the target tile
+     * @param target - x,y map coordinates of the target tile
      * @return -       Direction of shortest straight line distance to target
      */
-    direction targetTile(vector<int> target)
+    direction targetTile(Point target)
     {
-        vector<int> next_pos;  // Initialise next position, updated in each possible direction
-        float distance = 999;       // Set max distance to unreachable value
-        direction newDir;           // Initialise returned direction
+        uint8_t exits = currentExits();
+        Point next_pos;             // Initialise next position, updated in each possible direction
+        int distance = INT_MAX;     // Set max distance to unreachable value
+        direction newDir = dir;     // Initialise returned direction
+        bool byPath = pathTargeting && mazeDistance({getX(), getY()}, target) != NO_PATH;
 
         // Check UP exit
         // UP exits have an additional condition such that, at 4 specific intersections, the ghost cannot opt to travel UP
         if(!(getY() == 19 && (getX() == 12 || getX() == 15)) && !(getY() == 7 && (getX() == 12 || getX() == 15)))
         {
-            if(dir != DOWN && !isImpassible(getNextTile(UP)))   // Prevent direction reversing and ensure exit is traversible
+            if(dir != DOWN && (exits & EXIT_UP))    // Prevent direction reversing and ensure exit is traversible
             {
                 next_pos = {getX(), getY() + 1};
-                float d = distanceBetween(next_pos, target);    // Get distance between target and next tile in exit direction
-                if(d < distance)                                // If distance is shorter than any previously found, update direction to be returned
-                {                                               // Also update lowest found distance for future checks
+                int d = targetDistance(next_pos, target, byPath);   // Get distance between target and next tile in exit direction
+                if(d < distance)                                    // If distance is shorter than any previously found, update direction to be returned
+                {                                                   // Also update lowest found distance for future checks
                     distance = d;
-                    newDir = UP;                                // This process is repeated for all traversible exits from the current junction
+                    newDir = UP;                                    // This process is repeated for all traversible exits from the current junction
                 }
             }
         }
 
         // Check RIGHT exit
-        if(dir != LEFT && !isImpassible(getNextTile(RIGHT)))
+        if(dir != LEFT && (exits & EXIT_RIGHT))
         {
             next_pos = {getX() + 1, getY()};
-            float d = distanceBetween(next_pos, target);
+            int d = targetDistance(next_pos, target, byPath);
             if(d < distance)
             {
                 distance = d;
@@ -405,10 +408,10 @@ public:
         }
 
         // Check DOWN exit
-        if(dir != UP && !isImpassible(getNextTile(DOWN)))
+        if(dir != UP && (exits & EXIT_DOWN))
         {
             next_pos = {getX(), getY() - 1};
-            float d = distanceBetween(next_pos, target);
+            int d = targetDistance(next_pos, target, byPath);
             if(d < distance)
             {
                 distance = d;
@@ -417,10 +420,10 @@ public:
         }
 
         // Check LEFT exit
-        if(dir != RIGHT && !isImpassible(getNextTile(LEFT)))
+        if(dir != RIGHT && (exits & EXIT_LEFT))
         {
             next_pos = {getX() - 1, getY()};
-            float d = distanceBetween(next_pos, target);
+            int d = targetDistance(next_pos, target, byPath);
             if(d < distance)
             {
                 distance = d;
@@ -439,7 +442,7 @@ public:
      */
     void aiScatter()
     {
-        vector<int> target;
+        Point target;
         switch(colour)              // Each colour selects a unique corner to target
         {
             case RED:
@@ -458,28 +461,29 @@ public:
     /**
      * Calculate a target as Pac-Man's position +- an offset of given size in Pac-Man's direction of movement
      *
+     * @param pacman -     Pac-Man, whose position is targeted
      * @param offsetSize - Size of offset to apply
-     * @return -           New target vector, accounting for offset
+     * @return -           New target point, accounting for offset
      */
-    vector<int> targetPacmanOffsetBy(int offsetSize)
+    Point targetPacmanOffsetBy(Pacman& pacman, int offsetSize)
     {
-        vector<int> offset = {pacman.getX(), pacman.getY()};
+        Point offset = {pacman.getX(), pacman.getY()};
         switch(pacman.getDirection())   // Apply offset to correct coordinate based on Pacman's direction
         {
             case UP:
-                offset[1] += offsetSize;
+                offset.y += offsetSize;
                 break;
             case RIGHT:
-                offset[0] += offsetSize;
+                offset.x += offsetSize;
                 break;
             case DOWN:
-                offset[1] -= offsetSize;
+                offset.y -= offsetSize;
                 break;
             case LEFT:
-                offset[0] -= offsetSize;
+                offset.x -= offsetSize;
                 break;
         }
-        return offset;  // Return the new target vector, accounting for the offset
+        return offset;  // Return the new target point, accounting for the offset
     }
 
     /**
@@ -492,11 +496,14 @@ public:
      *                      Find vector from RED ghost to this point
      *                      Double this vector - the point at the end of this doubled vector is the target
      *      YELLOW: Targets and chases Pac-Man as RED does until within 8 tiles range, then emulating SCATTER behaviour
+     *
+     * @param pacman -   Pac-Man, who is being chased
+     * @param redGhost - RED ghost, used in BLUE's targeting
      */
-    void aiChase(Ghost redGhost)
+    void aiChase(Pacman& pacman, const Ghost& redGhost)
     {
-        vector<int> target = {pacman.getX(), pacman.getY()};   // Default target for RED and (sometimes) YELLOW
-        vector<int> current_pos = {getX(), getY()};            // Current position, stored as vector
+        Point target = {pacman.getX(), pacman.getY()};  // Default target for RED and (sometimes) YELLOW
+        Point current_pos = {getX(), getY()};           // Current position, stored as a point
         int d_x;    // Delta X initialised for use in BLUE's targeting
         int d_y;    // Delta Y initialised for use in BLUE's targeting
 
@@ -504,18 +511,18 @@ public:
         switch(colour)
         {
             case PINK:                              // PINK looks ahead of Pac-Man and tries to ambush him
-                target = targetPacmanOffsetBy(4);   // Update target to reflect offset in Pac-Man's direction of movement
+                target = targetPacmanOffsetBy(pacman, 4);   // Update target to reflect offset in Pac-Man's direction of movement
                 break;
             case BLUE:
-                target = targetPacmanOffsetBy(2);   // Start by finding the point 2 tiles ahead of Pac-Man in his direction of movement
-                d_x = target[0] - redGhost.getX();  // Find the X difference between this point and RED ghost
-                d_y = target[1] - redGhost.getY();  // Find the Y difference between this point and RED ghost
+                target = targetPacmanOffsetBy(pacman, 2);   // Start by finding the point 2 tiles ahead of Pac-Man in his direction of movement
+                d_x = target.x - redGhost.getX();   // Find the X difference between this point and RED ghost
+                d_y = target.y - redGhost.getY();   // Find the Y difference between this point and RED ghost
                 // BLUE's target is then twice the change in X and Y from RED's position
                 target = {redGhost.getX() + 2 * d_x, redGhost.getY() + 2 * d_y};
                 break;
             case YELLOW:
-                if(distanceBetween(current_pos, target) <= 8)   // If YELLOW is closer than 8 tiles to Pac-Man, he chases as RED does
-                    target = {0, -2};                           // If closer than 8 tiles, it emulates SCATTER AI behaviour
+                if(distanceSquared(current_pos, target) <= 8 * 8)   // If YELLOW is closer than 8 tiles to Pac-Man, he chases as RED does
+                    target = {0, -2};                               // If closer than 8 tiles, it emulates SCATTER AI behaviour
                 break;
         }
         dir = targetTile(target);   // Set direction to that of least straight line distance to target
@@ -524,16 +531,22 @@ public:
 
     /**
      * FRIGHTENED mode AI chooses a direction randomly at each junction, moving at half speed
+     * Every traversible exit of the junction is equally likely to be chosen
+     *
+     * @param rng - game's random number generator
      */
-    void aiFrightened()
+    void aiFrightened(Rng& rng)
     {
-        direction newDir;
-        do
+        uint8_t exits = currentExits();
+        direction choices[4];   // Traversible directions from UP, RIGHT, DOWN and LEFT
+        int count = 0;
+        for(int d = UP; d <= LEFT; d++)
         {
-            newDir = static_cast<direction>((rand() % LEFT) + 1);   // Choose random direction from UP, RIGHT, DOWN or LEFT
-        } while(isImpassible(getNextTile(newDir)));                 // Ensure random direction is traversible
+            if(exits & exitBit(static_cast<direction>(d)))
+                choices[count++] = static_cast<direction>(d);
+        }
 
-        dir = newDir;   // Set new direction
+        dir = choices[rng.nextInt(count)];  // Set new direction
         setSpeed(40);   // Set movement speed to 50%
     }
 
@@ -542,7 +555,7 @@ public:
      */
     void aiDead()
     {
-        vector<int> target = {14, 19};     // Coordinate directly above SPAWN entrance
+        Point target = {14, 19};    // Coordinate directly above SPAWN entrance
         dir = targetTile(target);
         setSpeed(200);
     }
@@ -560,8 +573,11 @@ public:
      *      Once within the pen, set AI mode to LEAVE, allowing the ghost to 'respawn'
      *
      * These cases are checked every tick that move() is called
+     *
+     * @param wave -        current AI wave, entered on leaving FRIGHTENED mode
+     * @param ghostsEaten - count of ghosts eaten since the last big pill, reset when FRIGHTENED mode ends
      */
-    void checkSpecialCases()
+    void checkSpecialCases(movement wave, int& ghostsEaten)
     {
         if(timeout >= 600)      // Timeout exceeds max time to be in FRIGHTENED mode
         {
@@ -578,11 +594,11 @@ public:
 
         if(ai == DEAD)
         {
-            if(x >= 13.4 && x <= 13.6)  // Check X position to check centrality
+            if(x >= PEN_X - 10 && x <= PEN_X + 10)  // Check X position to check centrality
             {
                 if(getY() == 19)    // Check ghost is also directly above the SPAWN pen
                 {
-                    x = 13.5;       // Correctly center X coordinate
+                    x = PEN_X;      // Correctly center X coordinate
                     dir = DOWN;     // Set ghost to enter the SPAWN pen
                     setSpeed(50);
                 }
@@ -603,44 +619,49 @@ public:
      *      d_pos: change in position, based on speed
      * While moving along an axis, the unchanging axis is rounded to prevent mishaps with discerning tile centrality
      *
-     * @param redGhost - RED ghost object is passed through the move method to CHASE mode AI for the BLUE ghost's targeting
+     * @param pacman -      Pac-Man, targeted by CHASE mode AI
+     * @param redGhost -    RED ghost object is passed through the move method to CHASE mode AI for the BLUE ghost's targeting
+     * @param wave -        current AI wave
+     * @param ghostsEaten - count of ghosts eaten since the last big pill
+     * @param rng -         game's random number generator, used by FRIGHTENED mode AI
      */
-    void move(Ghost redGhost)
+    void move(Pacman& pacman, const Ghost& redGhost, movement wave, int& ghostsEaten, Rng& rng)
     {
         // Check any special case AI behaviour
-        checkSpecialCases();
+        checkSpecialCases(wave, ghostsEaten);
 
         // Handle special case movement behaviours
+        uint8_t exits = currentExits();
         if(ai == SPAWN)         // Behaviour within SPAWN pen
             aiSpawn();
         else if(ai == LEAVE)    // AI to LEAVE SPAWN pen
-            aiLeave();
+            aiLeave(wave);
         // Handle PORTAL collision - only teleport if at center of tile
-        else if(atTileCenter() && getTile(getX(),getY()) == P)
+        else if(atTileCenter() && (exits & PORTAL))
         {
             if(dir == RIGHT)
-                x = 1;
+                x = 1 * SUB_TILE;
             else
-                x = 26;
+                x = 26 * SUB_TILE;
         }
         // If the a new AI mode has been set, reverse the current direction
         else if(reverse)
             reverseDirection();
-        // If no special case exists, direction can only be changed when 2 or more exits exist
-        else if(countExits() == 2 && isImpassible(getNextTile(dir)))    // Ghost is at corner so must turn
+        // If no special case exists, direction can only be changed at the center of a corner or junction
+        else if(atTileCenter() && (exits & CORNER) && !canExit(exits,dir))  // Ghost is at corner so must turn
             turnCorner();
-        else if(countExits() > 2)   // Ghost is at junction - run targeting AI and update direction
+        else if(atTileCenter() && (exits & JUNCTION))   // Ghost is at junction - run targeting AI and update direction
         {
             switch(ai)
             {
                 case SCATTER:       // Scatter all ghosts to each of the four corners
-                    aiScatter();        break;
+                    aiScatter();                    break;
                 case CHASE:         // Target and hunt Pac-Man, passing RED ghost for BLUE's AI
-                    aiChase(redGhost);  break;
+                    aiChase(pacman, redGhost);      break;
                 case FRIGHTENED:    // Flee from Pac-Man randomly
-                    aiFrightened();     break;
+                    aiFrightened(rng);              break;
                 case DEAD:
-                    aiDead();           break;
+                    aiDead();                       break;
             }
         }
 
@@ -655,26 +676,27 @@ public:
             case UP:
                 y += d_pos;
                 if(ai != SPAWN && ai != LEAVE && ai != DEAD)
-                    x = round(x);
+                    x = snapToTile(x);
                 break;
             case RIGHT:
                 x += d_pos;
                 if(ai != LEAVE)
-                    y = round(y);
+                    y = snapToTile(y);
                 break;
             case DOWN:
                 y -= d_pos;
                 if(ai != SPAWN && ai != LEAVE && ai != DEAD)
-                    x = round(x);
+                    x = snapToTile(x);
                 break;
             case LEFT:
                 x -= d_pos;
                 if(ai != LEAVE)
-                    y = round(y);
+                    y = snapToTile(y);
                 break;
         }
     }
 
+#ifndef PACMAN_HEADLESS
     /**
      * Draw ghost of correct colour at its current location
      */
@@ -683,11 +705,11 @@ public:
         // Reset drawScore flag - when eaten, drawEaten() is called during pause, do not draw score again
         drawScore = false;
 
-        glPushMatrix();
+        pushTranslation();
 
         translateMapOrigin();               // Translate to map origin
-        translateMapCoords(x,y);            // Translate to current (x,y)
-        glTranslatef(-3.0f, -3.0f, 0.0f);   // Account for over-sized sprite (14x14 on 8x8 tile)
+        translateSubTileCoords(x,y);        // Translate to current (x,y)
+        translate(-3.0f, -3.0f);   // Account for over-sized sprite (14x14 on 8x8 tile)
 
         // Determine which colour ghost to draw and whether it is the alternate texture (wiggle animation)
         unsigned int ghost_tex;
@@ -739,24 +761,31 @@ public:
             drawSprite(eyes_tex, 14, 14, 0);
         }
 
-        // Increment texture counter every frame
-        tex_count++;
+        popTranslation();
+    }
 
-        glPopMatrix();
+    /**
+     * Advance the ghost's animation by one tick, once per tick that it is drawn
+     */
+    void animate()
+    {
+        tex_count++;
     }
 
     /**
      * If ghost has just been eaten, draw the score for eating it, otherwise draw as normal
+     *
+     * @param ghostsEaten - count of ghosts eaten since the last big pill, determining the score drawn
      */
-    void drawEaten()
+    void drawEaten(int ghostsEaten)
     {
         if(drawScore)
         {
-            glPushMatrix();
+            pushTranslation();
 
             translateMapOrigin();               // Translate to map origin
-            translateMapCoords(x,y);            // Translate to current (x,y)
-            glTranslatef(-4.0f, 0.0f, 0.0f);    // Account for over-sized sprite (16x8 on 8x8 tile)
+            translateSubTileCoords(x,y);        // Translate to current (x,y)
+            translate(-4.0f, 0.0f);    // Account for over-sized sprite (16x8 on 8x8 tile)
 
             // Determine which score sprite to draw based on the number of ghosts eaten since the last big pill was eaten
             int ghostScore = min(ghostsEaten - 1, 3);
@@ -764,21 +793,22 @@ public:
             // Draw correct score sprite at current location
             drawSprite(g_scores_tex[ghostScore], 16, 8, 0);
 
-            glPopMatrix();
+            popTranslation();
         }
         else
             draw();     // If the ghost hasn't just been eaten, draw it as normal
     }
-};
 
-// Initialise array of ghosts, passing starting positions and colour
-Ghost ghosts[4] =
-        {
-                Ghost(13.5,19,RED),
-                Ghost(13.5,16,PINK),
-                Ghost(11.5,16,BLUE),
-                Ghost(15.5,16,YELLOW)
-        };
+    /**
+     * Advance the animation drawn by drawEaten() by one tick
+     */
+    void animateEaten()
+    {
+        if(!drawScore)
+            animate();
+    }
+#endif //PACMAN_HEADLESS
+};
 
 /**
  * Ghost AI targeting mode is set in waves, adding small respite where all enemies back off for a short period
@@ -798,9 +828,16 @@ Ghost ghosts[4] =
  *                      Above level 2, this decreases to 1 tick         approx. 1/60th of a second
  *      CHASE:      indefintely beyond this point
  * On changing wave, the ghost's direction is reversed
+ *
+ * @param ghosts - the four ghosts whose AI should follow the wave
+ * @param wave -   current AI wave, updated to reflect the game ticks
+ * @param ticks -  current game ticks
+ * @param level -  current level, shortening or extending certain waves
  */
-void aiWave()
+void aiWave(Ghost ghosts[4], movement& wave, int ticks, int level)
 {
+    PHASE(PHASE_WAVE);
+
     // Account for game not entering PLAY-mode until ticks=240
     int playTicks = ticks - 240;
     // SCATTER: 7s, or 5s if level 2+
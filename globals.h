@@ -6,31 +6,60 @@
 #ifndef PACMAN_GLOBALS_H
 #define PACMAN_GLOBALS_H
 
-// Game ticks, effectively enacting a frame counter
-int ticks = 0;
 /**
- * Timestamp represents symbolic points in the game, allowing specific frame-based timing from a certain tick:
- *      -1: default, unset state
- * Set to current ticks in a number of situations, effecting a short pause in the game
- * Set to current ticks on entering DEATH-mode, ensuring READY-mode is entered a given number of ticks later
+ * Complete state of a single game, owning the board, Pac-Man, all ghosts and every game-wide counter
+ * Nothing here is shared between games, so any number of games can be held and stepped within one process
  */
-int timestamp = -1;
+struct GameState
+{
+    // Game ticks, effectively enacting a frame counter
+    int ticks;
+    /**
+     * Timestamp represents symbolic points in the game, allowing specific frame-based timing from a certain tick:
+     *      -1: default, unset state
+     * Set to current ticks in a number of situations, effecting a short pause in the game
+     * Set to current ticks on entering DEATH-mode, ensuring READY-mode is entered a given number of ticks later
+     */
+    int timestamp;
+
+    // Game mode initialised to READY
+    gamemode mode;
+    gamemode tempMode;      // Save game mode when pausing the game
+
+    // Game score, level, remaining lives and extra life flag
+    int score;
+    int level;
+    int lives;
+    bool extraLife;         // True if received
 
-// Game mode initialised to READY
-gamemode mode = READY;
-gamemode tempMode;      // Save game mode when pausing the game
+    // Counts how many ghosts have been eaten since consuming the last big pill
+    int ghostsEaten;
 
-// Game score, level, remaining lives, extra life flag, remaining pills to be eaten, number of fruits consumed and fruit spawned flag all initialised
-int score = 0;
-int level = 1;
-int lives = 2;
-bool extraLife = false; // True if received
-int pillsLeft = 244;
-int fruits = 0;
-bool fruitSpawned = false;
+    // Ghost AI targeting is wave-based, varying between CHASE and SCATTER over time
+    movement wave;
 
-// Counts how many ghosts have been eaten since consuming the last big pill
-int ghostsEaten = 0;
+    // Game's own random number generator - the same seed and inputs always play out the same game
+    Rng rng;
+
+    Board board;            // Map, pills and fruits
+    Pacman pacman;          // Pac-Man
+    Ghost ghosts[4];        // Array of ghosts, initialised with starting positions and colour
+
+    // Seed determines every random choice made throughout the game
+    GameState(uint64_t seed = 0) : rng(seed), ghosts{Ghost(13.5,19,RED), Ghost(13.5,16,PINK), Ghost(11.5,16,BLUE), Ghost(15.5,16,YELLOW)}
+    {
+        ticks = 0;
+        timestamp = -1;
+        mode = READY;
+        tempMode = READY;
+        score = 0;
+        level = 1;
+        lives = 2;
+        extraLife = false;
+        ghostsEaten = 0;
+        wave = SCATTER;
+    }
+};
 
 /**
  * Reset level:
@@ -39,17 +68,17 @@ int ghostsEaten = 0;
  *      Enter READY mode
  * This function is called when advancing level, resetting a level on death, or when restarting the game
  */
-void resetLevel()
+void resetLevel(GameState& game)
 {
-    ticks = 0;
-    timestamp = -1;
-    pacman.reset();
-    wave = SCATTER;
-    ghostsEaten = 0;
-    fruitSpawned = false;
+    game.ticks = 0;
+    game.timestamp = -1;
+    game.pacman.reset();
+    game.wave = SCATTER;
+    game.ghostsEaten = 0;
+    game.board.fruitSpawned = false;
     for(int i = 0; i < 4; i++)
-        ghosts[i].reset();
-    mode = READY;
+        game.ghosts[i].reset(game.wave);
+    game.mode = READY;
 }
 
 /**
@@ -57,16 +86,61 @@ void resetLevel()
  * As mode=GAMEOVER, restart the game by resetting all variables to initial values
  * Also reset map, Pac-Man and ghosts to default
  */
-void restartGame()
+void restartGame(GameState& game)
+{
+    game.score = 0;
+    game.level = 1;
+    game.lives = 2;
+    game.extraLife = false;
+    game.board.fruits = 0;
+    resetMap(game.board);
+    resetLevel(game);
+}
+
+/**
+ * Pause the game, saving the game mode to re-enter on resuming
+ *
+ * @param game - game to pause
+ */
+void pauseGame(GameState& game)
+{
+    game.tempMode = game.mode;
+    game.mode = PAUSE;
+}
+
+/**
+ * Resume a paused game, re-entering the game mode it was paused in
+ *
+ * @param game - game to resume
+ */
+void resumeGame(GameState& game)
 {
-    score = 0;
-    level = 1;
-    lives = 2;
-    extraLife = false;
-    pillsLeft = 244;
-    fruits = 0;
-    resetMap();
-    resetLevel();
+    game.mode = game.tempMode;
+}
+
+/**
+ * Set whether the ghosts target tiles by their path distance through the maze, rather than the straight line distance
+ * the original game uses - an option kept for the whole game, across restarts
+ *
+ * @param game -    game whose ghosts to set
+ * @param enabled - true to target by path distance
+ */
+void setPathGhosts(GameState& game, bool enabled)
+{
+    for(int i = 0; i < 4; i++)
+        game.ghosts[i].setPathTargeting(enabled);
+}
+
+/**
+ * Set how many ticks ahead of a junction a turn may be pressed and still be taken there - an option kept for the whole
+ * game, across restarts
+ *
+ * @param game -  game in which to set the turn window
+ * @param ticks - ticks a turn is held for, or 0 to hold every turn until it can be taken
+ */
+void setTurnWindow(GameState& game, int ticks)
+{
+    game.pacman.setTurnWindow(ticks);
 }
 
 /**
@@ -81,92 +155,277 @@ void restartGame()
  *       - Set mode=DEATH if collision has occurred with alive ghost
  *       - If the ghost is frightened, eat it (set AI=DEAD)
  */
-void checkCollisions()
+void checkCollisions(GameState& game)
 {
     // Eat current tile, increment score
-    int scoreIncrement = pacman.eat();
-    score += scoreIncrement;
+    int scoreIncrement = game.pacman.eat(game.board);
+    game.score += scoreIncrement;
 
     if(scoreIncrement == 50)        // If score is increased by 50, a big pill has been eaten - set ghosts to FRIGHTENED
     {
         for(int i = 0; i < 4; i++)
         {
-            ghosts[i].zeroTimeout();    // Reset ghost FRIGHT timeout
-            if(ghosts[i].getAI() == wave || ghosts[i].getAI() == FRIGHTENED)
-                ghosts[i].setAI(FRIGHTENED, true);  // Set AI to FRIGHTENED if possible
+            game.ghosts[i].zeroTimeout(); // Reset ghost FRIGHT timeout
+            if(game.ghosts[i].getAI() == game.wave || game.ghosts[i].getAI() == FRIGHTENED)
+                game.ghosts[i].setAI(FRIGHTENED, true); // Set AI to FRIGHTENED if possible
         }
     }
     else if(scoreIncrement >= 100)  // If score is increased by more than 100, a fruit has been eaten, pause game briefly to show score
     {
-        timestamp = ticks;
-        pacman.stopChomping();
-        mode = FRUIT;
+        game.timestamp = game.ticks;
+        game.pacman.stopChomping();
+        game.mode = FRUIT;
     }
 
     // Award extra life for reaching 10000 points
-    if(!extraLife && score > 10000)
+    if(!game.extraLife && game.score > 10000)
     {
-        lives++;
-        extraLife = true;
+        game.lives++;
+        game.extraLife = true;
     }
 
     // If all pills have been eaten, stop Pac-Man's animation and set timestamp to restart level after short pause
-    if(pillsLeft == 0)
+    int pills = pillsLeft(game.board);
+    if(pills == 0)
     {
-        timestamp = ticks;
-        pacman.stopChomping();
+        game.timestamp = game.ticks;
+        game.pacman.stopChomping();
     }
         // Ghosts exit SPAWN pen when a certain number of pills have been eaten
         // To prevent all piling out at once after a death, tick timers only allow the ghosts to leave after a certain point
-    else if(ghosts[2].getAI() == SPAWN && pillsLeft <= 244 - 30 && ticks >= 300)    // BLUE leaves after 30 pills are eaten
-        ghosts[2].setAI(LEAVE, false);
-    else if(ghosts[3].getAI() == SPAWN && pillsLeft <= 244 * 2/3 && ticks >= 420)   // YELLOW leaves after 1/3 of the pills are eaten
-        ghosts[3].setAI(LEAVE, false);
+    else if(game.ghosts[2].getAI() == SPAWN && pills <= 244 - 30 && game.ticks >= 300) // BLUE leaves after 30 pills are eaten
+        game.ghosts[2].setAI(LEAVE, false);
+    else if(game.ghosts[3].getAI() == SPAWN && pills <= 244 * 2/3 && game.ticks >= 420) // YELLOW leaves after 1/3 of the pills are eaten
+        game.ghosts[3].setAI(LEAVE, false);
 
     // Check for ghost collisions
     for(int i = 0; i < 4; i++)
     {
-        if(ghosts[i].getX() == pacman.getX() && ghosts[i].getY() == pacman.getY())
+        if(game.ghosts[i].getX() == game.pacman.getX() && game.ghosts[i].getY() == game.pacman.getY())
         {
-            if(ghosts[i].getAI() == wave)   // If the ghost is alive and not FRIGHTENED, Pac-Man will die
-            {                               // Begin DEATH procedure by setting timestamp and stopping Pac-Man's animation
-                timestamp = ticks;
-                pacman.stopChomping();
+            if(game.ghosts[i].getAI() == game.wave)     // If the ghost is alive and not FRIGHTENED, Pac-Man will die
+            {                                           // Begin DEATH procedure by setting timestamp and stopping Pac-Man's animation
+                TRACE_EVENT("death");
+                game.timestamp = game.ticks;
+                game.pacman.stopChomping();
                 break;
             }
-            else if(ghosts[i].getAI() == FRIGHTENED)    // If ghost is FRIGHTENED, it can be eaten itself
-            {                                           // Set ghost AI to DEAD, increasing the score and count of ghosts eaten since the last big pill
-                ghosts[i].setAI(DEAD, false);            // Briefly pause the game to show score for eating ghost
-                score += 200 * pow(2, min(ghostsEaten++, 3));
-                timestamp = ticks;
-                pacman.stopChomping();
-                mode = EAT;
+            else if(game.ghosts[i].getAI() == FRIGHTENED)   // If ghost is FRIGHTENED, it can be eaten itself
+            {                                               // Set ghost AI to DEAD, increasing the score and count of ghosts eaten since the last big pill
+                game.ghosts[i].setAI(DEAD, false);          // Briefly pause the game to show score for eating ghost
+                game.score += 200 << min(game.ghostsEaten++, 3);
+                game.timestamp = game.ticks;
+                game.pacman.stopChomping();
+                game.mode = EAT;
             }
         }
     }
 }
 
+/**
+ * Advance the game by a single tick, computing all game logic
+ * Logic to compute varies on gamemode
+ *
+ * Contains no drawing, input handling or frame timing, allowing the game to be stepped both by the
+ * windowed game loop and by the headless simulation as fast as the CPU allows
+ */
+void stepGame(GameState& game)
+{
+    TRACE_SPAN("tick");
+    gamemode previousMode = game.mode;  // Mode before the tick, to trace any transition
+
+    // Perform certain logic depending on game mode
+    switch(game.mode)
+    {
+        case READY:     // After 240 ticks, enter PLAY mode
+            if(game.ticks > 240)
+                game.mode = PLAY;
+            break;
+        case PLAY:      // Main play loop
+            if(game.timestamp == -1)    // If timestamp is not set, execute all PLAY-mode logic
+            {
+                {
+                    PHASE(PHASE_COLLISIONS);        // Both checks are timed as one phase, Pac-Man's move within it as its own
+                    checkCollisions(game);          // Check Pac-Man's collisions with pills and ghosts
+                    game.pacman.move();             // Move Pac-Man
+                    checkCollisions(game);          // Check collisions again to ensure simultaneous tile switches register correct collisions
+                }
+                aiWave(game.ghosts, game.wave, game.ticks, game.level); // Update the ghost AI targeting wave
+                {
+                    PHASE(PHASE_GHOSTS);            // All four ghosts are timed as one phase
+                    // Move each ghost - pass RED ghost for BLUE's CHASE mode AI
+                    for(int i = 0; i < 4; i++)
+                        game.ghosts[i].move(game.pacman, game.ghosts[0], game.wave, game.ghostsEaten, game.rng);
+                }
+                // If no fruit is currently spawned, enough pills have been eaten,
+                // The eaten fruit count doesn't exceed the level and a random quantifier is satisfied, spawn a fruit
+                if(!game.board.fruitSpawned && game.board.fruits < game.level && pillsLeft(game.board) <= 240 - 30 && game.rng.nextInt(1500) == 0)
+                    spawnFruit(game.board, game.rng);
+            }
+            else
+            {
+                if(game.ticks == game.timestamp + 90)   // If timestamp is set, incur a short pause
+                {                                       // Timestamp is only set in PLAY-mode when Pac-Man dies or level is complete
+                    if(pillsLeft(game.board) == 0)      // If no pills remain, level is complete
+                    {                                   // Reset map and enter READY-mode for next level
+                        game.level++;
+                        resetMap(game.board);
+                        resetLevel(game);
+                    }
+                    else                                // If there are still pills remaining, Pac-Man has died
+                    {
+                        game.timestamp = game.ticks;    // Set timestamp for correct death animation timing
+                        game.mode = DEATH;              // Enter DEATH-mode
+                    }
+                }
+            }
+            break;
+        case FRUIT:     // Pause the game briefly on eating a fruit
+        case EAT:       // Also pause on eating a ghost - logical behaviour is identical so overflow switch case
+            if(game.ticks == game.timestamp + 90)
+            {
+                game.timestamp = -1;
+                game.pacman.startChomping();
+                game.mode = PLAY;
+            }
+            break;
+        case DEATH:     // 180 ticks after death, enter READY (reset level) or GAMEOVER mode depending on remaining lives
+            if(game.ticks > game.timestamp + 180)
+            {
+                if(game.lives == 0)
+                    game.mode = GAMEOVER; // High score is saved by the caller on entering GAMEOVER
+                else
+                {
+                    game.lives--;               // Decrease remaining lives on death
+                    resetFruit(game.board);     // Remove any spawned fruits
+                    resetLevel(game);           // Reset characters and variables to retry level
+                }
+            }
+            break;
+    }
+
+    // Increment game ticks and any spawned fruit's timer, but only if not paused
+    if(game.mode != PAUSE)
+    {
+        updateFruit(game.board);
+        game.ticks++;
+    }
+
+    if(game.mode != previousMode)
+        TRACE_EVENT(TRACE_MODE_NAMES[game.mode]);
+}
+
+#ifndef PACMAN_HEADLESS
 /**
  * Method tidies up display() switch on game mode, drawing common PLAY-mode features
  */
-void drawPlayScreen()
+void drawPlayScreen(GameState& game)
 {
-    drawMap();
-    drawLevel();
-    drawScore();
-    drawLives();
-    drawFruits();
+    drawMap(game.board, game.ticks);
+
+    PHASE(PHASE_UI);    // Time the rest of the screen as UI
+    drawLevel(game.level);
+    drawScore(game.score);
+    drawLives(game.lives);
+    drawFruits(game.board.fruits);
     drawHelp();
 }
 
+// Positions of Pac-Man & Ghosts at a given tick, in sub-tile units, from which drawing interpolates
+struct CharacterPositions
+{
+    Point pacman;
+    Point ghosts[4];
+};
+
+/**
+ * Record the positions of Pac-Man & Ghosts, before the game is stepped
+ *
+ * @param game - game whose characters to record
+ * @return -     positions of the characters
+ */
+CharacterPositions savePositions(const GameState& game)
+{
+    CharacterPositions positions;
+    positions.pacman = game.pacman.getPosition();
+    for(int i = 0; i < 4; i++)
+        positions.ghosts[i] = game.ghosts[i].getPosition();
+    return positions;
+}
+
+/**
+ * Translate from a character's current position back towards its previous one, so that it is drawn part way between
+ * Characters which moved more than a tile in one tick (through a portal, or reset) are drawn where they now are
+ *
+ * @param previous - position of the character at the previous tick, in sub-tile units
+ * @param current -  position of the character now, in sub-tile units
+ * @param alpha -    fraction of the way from the previous position to the current one at which to draw
+ */
+void translateInterpolated(Point previous, Point current, float alpha)
+{
+    int dx = previous.x - current.x;
+    int dy = previous.y - current.y;
+    if(abs(dx) > SUB_TILE || abs(dy) > SUB_TILE)
+        return;
+    translate(dx * (1.0f - alpha) * 8 / SUB_TILE, dy * (1.0f - alpha) * 8 / SUB_TILE);
+}
+
 /**
  * Method tidies up display() switch on game mode, drawing characters
+ * Each is drawn part way between its position at the previous tick and its current position
+ *
+ * @param game -     game whose characters to draw
+ * @param previous - positions of the characters at the previous tick
+ * @param alpha -    fraction of the time between ticks passed since the latest tick
  */
-void drawCharacters()
+void drawCharacters(GameState& game, const CharacterPositions& previous, float alpha)
 {
-    pacman.draw();
+    PHASE(PHASE_CHARACTERS);
+
+    pushTranslation();
+    translateInterpolated(previous.pacman, game.pacman.getPosition(), alpha);
+    game.pacman.draw();
+    popTranslation();
     for(int i = 0; i < 4; i++)
-        ghosts[i].draw();
+    {
+        pushTranslation();
+        translateInterpolated(previous.ghosts[i], game.ghosts[i].getPosition(), alpha);
+        game.ghosts[i].draw();
+        popTranslation();
+    }
+}
+
+/**
+ * Advance the animations of the characters drawn in the current game mode by one tick, as display() draws them
+ * Frames may be drawn several times per tick, so animations advance with the ticks rather than as they are drawn
+ *
+ * @param game - game whose characters to animate
+ */
+void animateCharacters(GameState& game)
+{
+    switch(game.mode)
+    {
+        case READY:
+        case PLAY:
+            game.pacman.animate();
+            for(int i = 0; i < 4; i++)
+                game.ghosts[i].animate();
+            break;
+        case FRUIT:
+            for(int i = 0; i < 4; i++)
+                game.ghosts[i].animate();
+            break;
+        case EAT:
+            for(int i = 0; i < 4; i++)
+                game.ghosts[i].animateEaten();
+            break;
+        case DEATH:
+            game.pacman.animateDead();
+            break;
+        default:
+            break;
+    }
 }
+#endif //PACMAN_HEADLESS
 
 #endif //PACMAN_GLOBALS_H
@@ -0,0 +1,109 @@
+/**
+ * Header file responsible for queueing keyboard input for the game logic, and measuring its latency
+ *
+ * Each direction pressed is stamped with the time it was received and pushed onto a single-producer single-consumer
+ * ring, which needs no lock - the input handlers alone push onto it, and the game loop alone pops from it, applying
+ * every input queued at the start of the next tick, in the order they were made. The latency of each input is measured
+ * from the time it was received to the time the first frame reflecting it was presented.
+ */
+
+#ifndef PACMAN_INPUT_H
+#define PACMAN_INPUT_H
+
+const int INPUT_EVENTS = 64;        // Inputs the ring can hold, a power of two - any more before the next tick are dropped
+const int LATENCY_SAMPLES = 256;    // Latest inputs over which the latency is reported
+
+// A direction pressed, and when it was received
+struct InputEvent
+{
+    direction dir;
+    steady_clock::time_point time;
+};
+
+struct InputRing
+{
+    InputEvent events[INPUT_EVENTS];
+    atomic<unsigned int> head;      // Count of inputs pushed, written only by the producer
+    atomic<unsigned int> tail;      // Count of inputs popped, written only by the consumer
+
+    InputRing() : head(0), tail(0) {}
+};
+
+// Latency of the inputs applied, from their receipt to the presentation of a frame reflecting them
+struct InputLatency
+{
+    steady_clock::time_point pending[INPUT_EVENTS];     // Times at which the inputs applied since the last frame were received
+    int pendingCount;                                   // Number of inputs awaiting a frame
+    float samples[LATENCY_SAMPLES];                     // Latency of each recent input, in milliseconds
+    int count;                                          // Inputs measured, wrapping around the samples
+
+    InputLatency()
+    {
+        pendingCount = 0;
+        count = 0;
+    }
+};
+
+/**
+ * Push an input onto the ring, from the producing thread
+ *
+ * @param ring -  ring to push onto
+ * @param input - input to push
+ * @return -      false if the ring is full, in which case the input is dropped
+ */
+bool pushInput(InputRing& ring, const InputEvent& input)
+{
+    unsigned int head = ring.head.load(memory_order_relaxed);
+    if(head - ring.tail.load(memory_order_acquire) == (unsigned int)INPUT_EVENTS)
+        return false;
+    ring.events[head & (INPUT_EVENTS - 1)] = input;
+    ring.head.store(head + 1, memory_order_release);   // Publish the input only once it has been written
+    return true;
+}
+
+/**
+ * Pop the oldest input from the ring, from the consuming thread
+ *
+ * @param ring -  ring to pop from
+ * @param input - set to the input popped
+ * @return -      false if the ring is empty
+ */
+bool popInput(InputRing& ring, InputEvent& input)
+{
+    unsigned int tail = ring.tail.load(memory_order_relaxed);
+    if(tail == ring.head.load(memory_order_acquire))
+        return false;
+    input = ring.events[tail & (INPUT_EVENTS - 1)];
+    ring.tail.store(tail + 1, memory_order_release);   // Free the slot only once the input has been read
+    return true;
+}
+
+/**
+ * Record that an input has been applied to the game, to be measured once the next frame is presented
+ *
+ * @param latency - latency measurements
+ * @param input -   input applied
+ */
+void inputApplied(InputLatency& latency, const InputEvent& input)
+{
+    if(latency.pendingCount < INPUT_EVENTS)
+        latency.pending[latency.pendingCount++] = input.time;
+}
+
+/**
+ * Measure the latency of every input applied since the last frame, now that a frame reflecting them is presented
+ *
+ * @param latency - latency measurements
+ * @param now -     time at which the frame was presented
+ */
+void framePresented(InputLatency& latency, steady_clock::time_point now)
+{
+    for(int i = 0; i < latency.pendingCount; i++)
+        latency.samples[latency.count++ % LATENCY_SAMPLES] = duration<float, milli>(now - latency.pending[i]).count();
+    latency.pendingCount = 0;
+}
+
+InputRing inputRing;            // Inputs received by the window, awaiting the next tick
+InputLatency inputLatency;      // Latency of the inputs received by the window
+
+#endif //PACMAN_INPUT_H
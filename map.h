@@ -7,17 +7,9 @@
 #ifndef PACMAN_MAP_H
 #define PACMAN_MAP_H
 
-// Allow access of ticks and fruit count from globals.h
-extern int ticks;
-extern int fruits;
-extern bool fruitSpawned;
-
-// Fruit timer incremented with each frame - fruit is removed after approx 10s if not eaten
-int fruitTimer = -1;
-
 /// TILES: 8x8, SPRITES: 14x14, MAP: 224x248, WINDOW: 300x300 - map starts at (38,26), ends at (262,274)
-// 2D tile array stores game map
-tile map[28][31] =
+// 2D tile array stores the pristine game map, copied into each game's board
+const tile mapLayout[28][31] =
         {
                 {W,W,W,W,W,W,W,W,W,W,W,W,n,n,n,W,P,W,n,n,n,W,W,W,W,W,W,W,W,W,W},
                 {W,o,o,o,o,W,W,O,o,o,o,W,n,n,n,W,n,W,n,n,n,W,o,o,o,o,O,o,o,o,W},
@@ -50,46 +42,259 @@ tile map[28][31] =
         };
 
 /**
- * Translates the current position of drawing to the bottom left corner of the map.
+ * One bit for every tile of the map, set where the tile holds something (such as a pill)
+ * The tile at (x,y) is bit x*31+y, so 868 tiles fit in 14 64-bit words
  */
-void translateMapOrigin()
+struct Bitboard
 {
-    glTranslatef(38.0f, 26.0f, 0.0f);
+    uint64_t words[14];
+
+    /**
+     * @param x - X coordinate in map
+     * @param y - Y coordinate in map
+     * @return -  true if the bit for the tile is set
+     */
+    bool test(int x, int y) const
+    {
+        int i = x * 31 + y;
+        return (words[i / 64] >> (i % 64)) & 1;
+    }
+
+    /**
+     * @param x - X coordinate in map
+     * @param y - Y coordinate in map
+     */
+    void set(int x, int y)
+    {
+        int i = x * 31 + y;
+        words[i / 64] |= (uint64_t)1 << (i % 64);
+    }
+
+    /**
+     * @param x - X coordinate in map
+     * @param y - Y coordinate in map
+     */
+    void clear(int x, int y)
+    {
+        int i = x * 31 + y;
+        words[i / 64] &= ~((uint64_t)1 << (i % 64));
+    }
+
+    /**
+     * Count the bits set, using a portable bit-parallel popcount of each word
+     *
+     * @return - number of bits set
+     */
+    int count() const
+    {
+        int n = 0;
+        for(int w = 0; w < 14; w++)
+        {
+            uint64_t v = words[w];
+            v = v - ((v >> 1) & 0x5555555555555555ULL);                             // Count bits in each pair
+            v = (v & 0x3333333333333333ULL) + ((v >> 2) & 0x3333333333333333ULL);   // Sum pairs into nibbles
+            v = (v + (v >> 4)) & 0x0F0F0F0F0F0F0F0FULL;                             // Sum nibbles into bytes
+            n += (v * 0x0101010101010101ULL) >> 56;                                 // Sum bytes into the top byte
+        }
+        return n;
+    }
+};
+
+/**
+ * Build a bitboard with a bit set for every tile of the given type in the map layout
+ *
+ * @param t - tile type to find
+ * @return -  bitboard of every tile of type t
+ */
+Bitboard layoutBitboard(tile t)
+{
+    Bitboard bits = {};
+    for(int x=0;x<28;x++)
+        for(int y=0;y<31;y++)
+            if(mapLayout[x][y] == t)
+                bits.set(x,y);
+    return bits;
 }
 
+// Pristine pills and big pills of the map layout, copied into each board whenever the map is reset
+const Bitboard layoutPills = layoutBitboard(o);
+const Bitboard layoutBigPills = layoutBitboard(O);
+
+// Number of pill tiles in the lower third of the map (X 1-27, Y 1-10) - once eaten, a fruit can spawn on any of them
+const int FRUIT_TILES = 120;
+
 /**
- * Translate to a given (x,y) in map coordinates within the window
+ * Numbering of the tiles on which fruits can spawn, built once from the map layout
+ * The layout must hold exactly FRUIT_TILES of them - any other number aborts at startup, rather than leaving tiles
+ * unnumbered or numbers without a tile
+ */
+struct FruitTileTable
+{
+    Point tiles[FRUIT_TILES];   // Each fruit tile, by number
+    int8_t number[28][31];      // Number of each tile among the fruit tiles, -1 if a fruit can't spawn there
+
+    FruitTileTable()
+    {
+        int count = 0;
+        for(int x=0;x<28;x++)
+        {
+            for(int y=0;y<31;y++)
+            {
+                number[x][y] = -1;
+                if(x >= 1 && y >= 1 && y <= 10 && mapLayout[x][y] == o)
+                {
+                    if(count < FRUIT_TILES)     // Counting on past the table, only to report the true number below
+                    {
+                        tiles[count] = {x, y};
+                        number[x][y] = count;
+                    }
+                    count++;
+                }
+            }
+        }
+        if(count != FRUIT_TILES)
+        {
+            fprintf(stderr, "Map layout holds %d fruit tiles, where FRUIT_TILES is %d\n", count, FRUIT_TILES);
+            abort();
+        }
+    }
+};
+
+const FruitTileTable fruitTiles;
+
+/**
+ * A single game's pill and fruit state, which changes as the map is eaten
+ * Walls, gates and portals never change, so are read from the shared map layout and exit table rather than stored here
+ * Each game owns its own board, so any number of games can be played at once
  *
- * @param x - x coordinate relative to game map
- * @param y - y coordinate relative to game map
+ * The fruit tiles whose pill has been eaten - those on which a fruit can spawn - are kept in a sparse set:
+ * emptyTiles lists them densely, and emptyIndex gives each one's position within that list. Adding, removing and
+ * picking a random tile are all O(1), and clearing the whole set is just emptyCount=0
  */
-void translateMapCoords(float x, float y)
+struct Board
+{
+    Bitboard pills;     // Remaining pills
+    Bitboard bigPills;  // Remaining big pills
+    int pillCount;      // Popcount of pills and big pills, refreshed only when either changes - read every tick
+    int8_t fruitX;      // X coordinate of the spawned fruit, -1 if none
+    int8_t fruitY;      // Y coordinate of the spawned fruit
+    uint8_t emptyCount;                 // Number of fruit tiles whose pill has been eaten
+    uint8_t emptyTiles[FRUIT_TILES];    // Numbers of the fruit tiles whose pill has been eaten, in no particular order
+    uint8_t emptyIndex[FRUIT_TILES];    // Position of each fruit tile within emptyTiles, only meaningful if it is there
+    int fruits;         // Number of fruits consumed
+    bool fruitSpawned;  // True while a fruit is on the map
+    int fruitTimer;     // Fruit timer incremented with each tick - fruit is removed after approx 30s if not eaten
+
+    Board()
+    {
+        pills = layoutPills;
+        bigPills = layoutBigPills;
+        pillCount = pills.count() + bigPills.count();
+        fruitX = -1;
+        fruitY = -1;
+        emptyCount = 0;
+        memset(emptyTiles, 0, sizeof(emptyTiles));
+        memset(emptyIndex, 0, sizeof(emptyIndex));
+        fruits = 0;
+        fruitSpawned = false;
+        fruitTimer = -1;
+    }
+};
+
+/**
+ * Determine whether a fruit tile is in the board's set of empty fruit tiles
+ *
+ * @param board -  board to check
+ * @param number - number of the fruit tile
+ * @return -       true if the tile's pill has been eaten
+ */
+bool isEmptyFruitTile(const Board& board, int number)
 {
-    glTranslatef(x * 8, y * 8, 0.0f);
+    int i = board.emptyIndex[number];
+    return i < board.emptyCount && board.emptyTiles[i] == number;
 }
 
 /**
- * Get tile at given location in map
+ * Get tile at given location in map, combining the map layout with the board's pills and fruit
  *
- * @param x - X coordinate in map
- * @param y - Y coordinate in map
- * @return -  tile at given position
+ * @param board - board from which to read the tile
+ * @param x -     X coordinate in map
+ * @param y -     Y coordinate in map
+ * @return -      tile at given position
  */
-tile getTile(int x, int y)
+tile getTile(const Board& board, int x, int y)
 {
-    return map[x][y];
+    switch(mapLayout[x][y])
+    {
+        case o:
+            if(x == board.fruitX && y == board.fruitY)
+                return F;
+            return board.pills.test(x,y) ? o : e;
+        case O:
+            return board.bigPills.test(x,y) ? O : E;
+        default:
+            return mapLayout[x][y];
+    }
 }
 
 /**
  * Set tile at given location in map to given type
+ * Only pill and fruit tiles can change - eating a pill (e, E), restoring one (o, O) or spawning a fruit (F)
  *
- * @param x - X coordinate in map to be updated
- * @param y - Y coordinate in map to be updated
- * @param t - tile to which position in map should be updated
+ * @param board - board to be updated
+ * @param x -     X coordinate in map to be updated
+ * @param y -     Y coordinate in map to be updated
+ * @param t -     tile to which position in map should be updated
  */
-void setTile(int x, int y, tile t)
+void setTile(Board& board, int x, int y, tile t)
 {
-    map[x][y] = t;
+    if(x == board.fruitX && y == board.fruitY)  // Any change to the fruit's tile removes the fruit
+    {
+        board.fruitX = -1;
+        board.fruitY = -1;
+    }
+
+    int number = fruitTiles.number[x][y];
+    switch(t)
+    {
+        case o:
+            board.pills.set(x,y);
+            if(number != -1 && isEmptyFruitTile(board, number))    // Remove from the empty fruit tiles, moving the last in its place
+            {
+                uint8_t last = board.emptyTiles[--board.emptyCount];
+                board.emptyTiles[board.emptyIndex[number]] = last;
+                board.emptyIndex[last] = board.emptyIndex[number];
+            }
+            break;
+        case e:
+            board.pills.clear(x,y);
+            if(number != -1 && !isEmptyFruitTile(board, number))   // Add to the empty fruit tiles
+            {
+                board.emptyIndex[number] = board.emptyCount;
+                board.emptyTiles[board.emptyCount++] = number;
+            }
+            break;
+        case O:
+            board.bigPills.set(x,y); break;
+        case E:
+            board.bigPills.clear(x,y); break;
+        case F:
+            board.fruitX = x;
+            board.fruitY = y;
+            return;     // Fruits never change the pill count
+    }
+    board.pillCount = board.pills.count() + board.bigPills.count();
+}
+
+/**
+ * Get the number of pills and big pills remaining on the board
+ *
+ * @param board - board on which to count
+ * @return -      number of pills remaining
+ */
+int pillsLeft(const Board& board)
+{
+    return board.pillCount;
 }
 
 /**
@@ -103,122 +308,492 @@ bool isImpassible(tile t)
 }
 
 /**
- * Iterates through map array repopulating it with pills where they have been eaten
+ * Flags stored for every tile in the exit table:
+ *      EXIT_UP, EXIT_RIGHT, EXIT_DOWN, EXIT_LEFT: the neighbouring tile in that direction is passable
+ *      JUNCTION: three or more exits, where ghosts run their targeting AI
+ *      CORNER:   exactly two exits at right angles, where ghosts must turn
+ *      PORTAL:   the tile is a portal
  */
-void resetMap()
+const uint8_t EXIT_UP    = 1 << 0;
+const uint8_t EXIT_RIGHT = 1 << 1;
+const uint8_t EXIT_DOWN  = 1 << 2;
+const uint8_t EXIT_LEFT  = 1 << 3;
+const uint8_t EXITS      = EXIT_UP | EXIT_RIGHT | EXIT_DOWN | EXIT_LEFT;
+const uint8_t JUNCTION   = 1 << 4;
+const uint8_t CORNER     = 1 << 5;
+const uint8_t PORTAL     = 1 << 6;
+
+/**
+ * Get the exit flag corresponding to a direction of movement
+ *
+ * @param d - direction of movement
+ * @return -  exit flag for d, or 0 if d=NONE
+ */
+uint8_t exitBit(direction d)
 {
-    for(int x=0;x<28;x++)
+    return d == NONE ? 0 : 1 << (d - UP);
+}
+
+/**
+ * Table of exit flags for every tile of the maze, built once from the map layout
+ * Walls and gates never change during a game - only pills and fruits do - so one table serves every board
+ * Portal tiles wrap around to the opposite side of the map
+ */
+struct ExitTable
+{
+    uint8_t exits[28][31];
+
+    ExitTable()
     {
-        for(int y=0;y<31;y++)
+        for(int x=0;x<28;x++)
         {
-            switch(getTile(x,y))
+            for(int y=0;y<31;y++)
             {
-                case F:     // Fruits only spawn on empty pill tiles, not empty big pill tiles - if it still exists on map reset, reset to pill
-                case e:
-                    setTile(x,y,o); break;
-                case E:
-                    setTile(x,y,O); break;
+                uint8_t flags = 0;
+                if(y < 30 && !isImpassible(mapLayout[x][y + 1]))
+                    flags |= EXIT_UP;
+                if(!isImpassible(mapLayout[(x + 1) % 28][y]))
+                    flags |= EXIT_RIGHT;
+                if(y > 0 && !isImpassible(mapLayout[x][y - 1]))
+                    flags |= EXIT_DOWN;
+                if(!isImpassible(mapLayout[(x + 27) % 28][y]))
+                    flags |= EXIT_LEFT;
+
+                int count = 0;
+                for(int d = UP; d <= LEFT; d++)
+                    count += (flags & exitBit(static_cast<direction>(d))) != 0;
+                if(count > 2)
+                    flags |= JUNCTION;
+                else if(count == 2 && flags != (EXIT_UP | EXIT_DOWN) && flags != (EXIT_LEFT | EXIT_RIGHT))
+                    flags |= CORNER;
+                if(mapLayout[x][y] == P)
+                    flags |= PORTAL;
+
+                exits[x][y] = flags;
             }
         }
     }
+};
+
+const ExitTable exitTable;
+
+/**
+ * Get the exit flags of the tile at given location in map
+ *
+ * @param x - X coordinate in map
+ * @param y - Y coordinate in map
+ * @return -  exit flags of the tile
+ */
+uint8_t getExits(int x, int y)
+{
+    return exitTable.exits[x][y];
+}
+
+/**
+ * Return true if movement in the given direction is possible from a tile with the given exits
+ * Stopping (d=NONE) is always possible
+ *
+ * @param exits - exit flags of the current tile
+ * @param d -     direction of movement
+ * @return -      bool, true if the tile can be left in direction d
+ */
+bool canExit(uint8_t exits, direction d)
+{
+    return d == NONE || (exits & exitBit(d));
+}
+
+/**
+ * Repopulate the map with pills where they have been eaten, by copying the pristine pill bitboards
+ * Fruits only spawn on empty pill tiles, so any fruit still on the map is replaced by a pill
+ */
+void resetMap(Board& board)
+{
+    board.pills = layoutPills;
+    board.bigPills = layoutBigPills;
+    board.pillCount = board.pills.count() + board.bigPills.count();
+    board.fruitX = -1;
+    board.fruitY = -1;
+    board.emptyCount = 0;   // Every fruit tile is full again
 }
 
 /**
  * When Pac-Man dies, remove any spawned fruits from the map
  */
-void resetFruit()
+void resetFruit(Board& board)
 {
-    for(int x=0;x<28;x++)
+    board.fruitX = -1;
+    board.fruitY = -1;
+}
+
+/**
+ * Randomly spawn a fruit on one of the empty pill tiles in the lower third of the map
+ * Every empty tile is equally likely, and is picked directly from the set of empty fruit tiles
+ *
+ * @param board - board on which to spawn the fruit
+ * @param rng -   game's random number generator
+ */
+void spawnFruit(Board& board, Rng& rng)
+{
+    if(board.emptyCount == 0)   // No pills have yet been eaten in the lower third of the map, so nowhere to spawn
+        return;
+
+    Point p = fruitTiles.tiles[board.emptyTiles[rng.nextInt(board.emptyCount)]];
+
+    // Spawn fruit on the randomly selected empty tile and set timer to 0
+    setTile(board,p.x,p.y,F);
+    board.fruitSpawned = true;
+    board.fruitTimer = 0;
+    TRACE_EVENT("spawnFruit");
+}
+
+/**
+ * Advance the spawned fruit's timer by one tick
+ * If the timer exceeds 900 ticks (approx 30s) remove the fruit and reset the timer
+ */
+void updateFruit(Board& board)
+{
+    if(board.fruitTimer == -1)
+        return;
+
+    if(board.fruitTimer < 900)
+        board.fruitTimer++;
+    else
     {
-        for(int y=0;y<31;y++)
+        resetFruit(board);
+        board.fruitTimer = -1;
+    }
+}
+
+#ifndef PACMAN_HEADLESS
+/**
+ * Translates the current position of drawing to the bottom left corner of the map.
+ */
+void translateMapOrigin()
+{
+    translate(38.0f, 26.0f);
+}
+
+/**
+ * Translate to a given (x,y) in map coordinates within the window
+ *
+ * @param x - x coordinate relative to game map
+ * @param y - y coordinate relative to game map
+ */
+void translateMapCoords(float x, float y)
+{
+    translate(x * 8, y * 8);
+}
+
+/**
+ * Translate to a given (x,y) in map coordinates within the window, given in sub-tile units as Pac-Man & Ghosts store them
+ *
+ * @param x - x coordinate relative to game map, in sub-tile units
+ * @param y - y coordinate relative to game map, in sub-tile units
+ */
+void translateSubTileCoords(int x, int y)
+{
+    translateMapCoords((float)x / SUB_TILE, (float)y / SUB_TILE);
+}
+
+/**
+ * Draw a square sprite centred on every tile whose bit is set in a bitboard, visiting only the set bits
+ *
+ * @param bits - bitboard of tiles on which to draw
+ * @param tex -  texture to draw
+ * @param size - width and height of the sprite - sprites larger than the 8x8 tile overhang it equally on each side
+ */
+void drawBitboard(const Bitboard& bits, unsigned int tex, int size)
+{
+    for(int w = 0; w < 14; w++)
+    {
+        for(uint64_t word = bits.words[w]; word != 0; word &= word - 1)    // Clear the lowest set bit each iteration
         {
-            switch(getTile(x,y))
-            {
-                case F:     // Fruits only spawn on empty pill tiles, not empty big pill tiles - if it still exists on map reset, reset to pill
-                    setTile(x,y,e); break;
-            }
+            int i = w * 64 + __builtin_ctzll(word);
+            pushTranslation();
+            translateMapCoords(i / 31, i % 31);                     // Translate to the tile's (x,y)
+            translate((8 - size) / 2, (8 - size) / 2);              // Account for over-sized sprite
+            drawSprite(tex, size, size, 0);
+            popTranslation();
         }
     }
 }
 
 /**
- * Randomly spawn a fruit in the lower third of the map
+ * Cached layer of the map, holding the map sprite with the small pills drawn over it
+ * The layer is rendered once into a texture through a framebuffer object, then patched only where pills have been
+ * eaten or restored since the last frame, leaving just the animated big pills and the fruit to be drawn every frame.
+ * It covers exactly the pixels of the viewport that the map covers, so that it can be copied into place pixel for pixel.
+ */
+struct MapLayer
+{
+    bool supported;                     // True if framebuffer objects are available to render the layer into
+    bool valid;                         // True once the layer has been rendered for the current viewport
+    unsigned int texture;               // Texture holding the layer
+    unsigned int framebuffer;           // Framebuffer object rendering into the texture
+    int textureWidth, textureHeight;    // Size of the texture, rounded up to powers of two
+    int viewport[4];                    // Viewport the layer was rendered for
+    int x, y, width, height;            // Pixels of the viewport covered by the map, held from the texture's bottom left
+    Bitboard pills;                     // Small pills rendered into the layer
+};
+
+MapLayer mapLayer;
+
+// Number of changed tiles beyond which the layer is rendered afresh rather than patched, such as on a new level
+const int MAX_LAYER_PATCHES = 32;
+
+/**
+ * Set up the map layer on init, once a GL context exists
+ */
+void initMapLayer()
+{
+    mapLayer.supported = loadFramebufferFunctions();
+    mapLayer.valid = false;
+    mapLayer.textureWidth = 0;
+    mapLayer.textureHeight = 0;
+    if(!mapLayer.supported)
+        return;
+
+    glGenTextures(1, &mapLayer.texture);
+    genFramebuffers(1, &mapLayer.framebuffer);
+}
+
+/**
+ * Convert an x coordinate of the window, in world coordinates, to a pixel of the viewport (world is 300x300)
+ *
+ * @param x - x coordinate in world coordinates
+ * @return -  pixel column, rounded down
+ */
+int toPixelX(float x)
+{
+    return (int)floor(x * mapLayer.viewport[2] / 300.0f);
+}
+
+/**
+ * Convert a y coordinate of the window, in world coordinates, to a pixel of the viewport (world is 300x300)
+ *
+ * @param y - y coordinate in world coordinates
+ * @return -  pixel row, rounded down
+ */
+int toPixelY(float y)
+{
+    return (int)floor(y * mapLayer.viewport[3] / 300.0f);
+}
+
+/**
+ * Direct all drawing into the map layer, until endLayer() is called
+ * The viewport is offset so that the map lands in the bottom left corner of the layer, unscaled
  */
-void spawnFruit()
+void beginLayer()
 {
-    int x;
-    int y;
-    do
+    flushSprites();
+    bindFramebuffer(GL_FRAMEBUFFER_EXT, mapLayer.framebuffer);
+    glViewport(-mapLayer.x, -mapLayer.y, mapLayer.viewport[2], mapLayer.viewport[3]);
+}
+
+/**
+ * Return drawing to the window, once the map layer has been drawn into
+ */
+void endLayer()
+{
+    flushSprites();
+    bindFramebuffer(GL_FRAMEBUFFER_EXT, 0);
+    glViewport(mapLayer.viewport[0], mapLayer.viewport[1], mapLayer.viewport[2], mapLayer.viewport[3]);
+}
+
+/**
+ * Render the whole map layer afresh for the current viewport, resizing its texture if needed
+ * The current translation must be the map origin
+ *
+ * @param board - board whose pills to draw
+ * @return -      false if the layer cannot be rendered into, in which case the map must be drawn directly
+ */
+bool renderLayer(const Board& board)
+{
+    glGetIntegerv(GL_VIEWPORT, mapLayer.viewport);
+    mapLayer.x = toPixelX(38.0f);
+    mapLayer.y = toPixelY(26.0f);
+    mapLayer.width = toPixelX(38.0f + 224.0f) + 1 - mapLayer.x;
+    mapLayer.height = toPixelY(26.0f + 248.0f) + 1 - mapLayer.y;
+
+    if(mapLayer.width > mapLayer.textureWidth || mapLayer.height > mapLayer.textureHeight)
     {
-        x = rand() % 27 + 1;    // Generate random X within the map (excluding outer walls)
-        y = rand() % 10 + 1;    // Generate random Y within the lower third of the map (excluding outer walls)
-    } while(getTile(x,y) != e); // Randomly selected tile must be empty
+        for(mapLayer.textureWidth = 1; mapLayer.textureWidth < mapLayer.width; mapLayer.textureWidth *= 2);
+        for(mapLayer.textureHeight = 1; mapLayer.textureHeight < mapLayer.height; mapLayer.textureHeight *= 2);
+
+        glBindTexture(GL_TEXTURE_2D, mapLayer.texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);    // Layer is copied, never scaled
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, mapLayer.textureWidth, mapLayer.textureHeight, 0, GL_RGBA,
+                     GL_UNSIGNED_BYTE, NULL);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        bindFramebuffer(GL_FRAMEBUFFER_EXT, mapLayer.framebuffer);
+        framebufferTexture2D(GL_FRAMEBUFFER_EXT, GL_COLOR_ATTACHMENT0_EXT, GL_TEXTURE_2D, mapLayer.texture, 0);
+        bool complete = checkFramebufferStatus(GL_FRAMEBUFFER_EXT) == GL_FRAMEBUFFER_COMPLETE_EXT;
+        bindFramebuffer(GL_FRAMEBUFFER_EXT, 0);
+        if(!complete)
+        {
+            mapLayer.supported = false;
+            return false;
+        }
+    }
+
+    beginLayer();
+    glClear(GL_COLOR_BUFFER_BIT);
+    drawSprite(map_tex, 224, 248, 0);
+    drawBitboard(board.pills, pill_tex, 8);
+    endLayer();
 
-    // Once randomly selected tile is empty, spawn fruit and set timer to 0
-    setTile(x,y,F);
-    fruitSpawned = true;
-    fruitTimer = 0;
+    mapLayer.pills = board.pills;
+    mapLayer.valid = true;
+    return true;
 }
 
 /**
- * Determine which fruit to draw based on how many have already been consumed
- * If the timer exceeds 600 ticks (approx 15s) remove the fruit and reset the timer
+ * Patch the map layer wherever a small pill has been eaten or restored since it was last drawn
+ * Each changed tile is cleared and redrawn alone, clipped by the scissor test - along with the pills around it, should
+ * the clipped area reach into neighbouring tiles at the current scale
+ * The current translation must be the map origin
+ *
+ * @param board - board whose pills to draw
+ * @param diff -  tiles whose pills have changed
  */
-void drawFruit(int x, int y)
+void patchLayer(const Board& board, const Bitboard& diff)
 {
-    if(fruitTimer <= 900)
+    beginLayer();
+    glEnable(GL_SCISSOR_TEST);
+    for(int w = 0; w < 14; w++)
     {
-        glPushMatrix();
+        for(uint64_t word = diff.words[w]; word != 0; word &= word - 1)
+        {
+            int i = w * 64 + __builtin_ctzll(word);
+            int x = i / 31;
+            int y = i % 31;
 
-        glTranslatef(-3.0f, -3.0f, 0.0f);   // Account for over-sized sprite (14x14 on 8x8 tile)
+            // Clip to the pixels covered by the tile
+            int left = toPixelX(38.0f + x * 8) - mapLayer.x;
+            int bottom = toPixelY(26.0f + y * 8) - mapLayer.y;
+            glScissor(left, bottom, toPixelX(38.0f + x * 8 + 8) + 1 - mapLayer.x - left,
+                      toPixelY(26.0f + y * 8 + 8) + 1 - mapLayer.y - bottom);
 
-        // Determine which fruit sprite to draw from the array based on current fruit consumption count
-        drawSprite(fruits_tex[fruits], 14, 14, 0);  // Draw fruit at current location
+            Bitboard nearby = {};
+            for(int nx = max(x - 1, 0); nx <= min(x + 1, 27); nx++)
+            {
+                for(int ny = max(y - 1, 0); ny <= min(y + 1, 30); ny++)
+                {
+                    if(board.pills.test(nx, ny))
+                        nearby.set(nx, ny);
+                }
+            }
+
+            glClear(GL_COLOR_BUFFER_BIT);
+            drawSprite(map_tex, 224, 248, 0);
+            drawBitboard(nearby, pill_tex, 8);
+            flushSprites();     // Draw before the clipped area moves on
+        }
+    }
+    glDisable(GL_SCISSOR_TEST);
+    endLayer();
+
+    mapLayer.pills = board.pills;
+}
 
-        glPopMatrix();
-        fruitTimer++;
+/**
+ * Bring the map layer up to date with the board, then copy it into place in the window
+ * The current translation must be the map origin
+ *
+ * @param board - board whose pills to draw
+ * @return -      false if the layer cannot be used, in which case the map must be drawn directly
+ */
+bool drawLayer(const Board& board)
+{
+    int viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    if(!mapLayer.valid || memcmp(viewport, mapLayer.viewport, sizeof(viewport)) != 0)
+    {
+        if(!renderLayer(board))
+            return false;
     }
     else
     {
-        setTile(x,y,e);
-        fruitTimer = -1;
+        Bitboard diff;
+        for(int w = 0; w < 14; w++)
+            diff.words[w] = board.pills.words[w] ^ mapLayer.pills.words[w];
+
+        int changed = diff.count();
+        if(changed > MAX_LAYER_PATCHES)
+            renderLayer(board);
+        else if(changed > 0)
+            patchLayer(board, diff);
     }
+
+    // Copy the layer in place of drawing the map, which is always drawn first, over the cleared window
+    flushSprites();
+    float left = mapLayer.x * 300.0f / mapLayer.viewport[2];
+    float bottom = mapLayer.y * 300.0f / mapLayer.viewport[3];
+    float right = (mapLayer.x + mapLayer.width) * 300.0f / mapLayer.viewport[2];
+    float top = (mapLayer.y + mapLayer.height) * 300.0f / mapLayer.viewport[3];
+    float u = (float)mapLayer.width / mapLayer.textureWidth;
+    float v = (float)mapLayer.height / mapLayer.textureHeight;
+
+    glDisable(GL_BLEND);
+    glEnable(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, mapLayer.texture);
+    PROFILE_COUNT(COUNTER_BINDS);
+    PROFILE_COUNT(COUNTER_DRAWS);
+    glBegin(GL_QUADS);
+        glTexCoord2f(0.0f, 0.0f);
+        glVertex2f(left, bottom);
+        glTexCoord2f(u, 0.0f);
+        glVertex2f(right, bottom);
+        glTexCoord2f(u, v);
+        glVertex2f(right, top);
+        glTexCoord2f(0.0f, v);
+        glVertex2f(left, top);
+    glEnd();
+    glDisable(GL_TEXTURE_2D);
+    glEnable(GL_BLEND);
+    return true;
 }
 
 /**
- * Iterates through the map array, drawing all pills. Also draws map as a sprite.
+ * Draws map as a sprite, then draws all pills and fruits from the board's bitboards.
+ * The map and small pills come from the cached map layer where possible, otherwise they are drawn directly.
+ *
+ * @param board - board to draw
+ * @param ticks - current game ticks, determining the size of big pills
  */
-void drawMap()
+void drawMap(const Board& board, int ticks)
 {
-    glPushMatrix();
+    PHASE(PHASE_MAP);
+
+    pushTranslation();
 
     translateMapOrigin();               // Translate to map origin
-    drawSprite(map_tex, 224, 248, 0);   // Draw map as a sprite
-    for(int x=0;x<28;x++)               // Loop populates map
+    if(!mapLayer.supported || !drawLayer(board))
     {
-        glPushMatrix();
+        drawSprite(map_tex, 224, 248, 0);           // Draw map as a sprite
+        drawBitboard(board.pills, pill_tex, 8);     // Draw pills as sprites
+    }
 
-        for(int y=0;y<31;y++)
-        {
-            // Determine size of big pills to draw depending on ticks
-            int bigPill = floor(ticks % 40 / 20);
+    // Determine size of big pills to draw depending on ticks
+    int bigPill = ticks % 40 / 20;
 
-            switch(getTile(x,y))    // Draw pills as sprites
-            {
-                case o:
-                    drawSprite(pill_tex, 8, 8, 0); break;
-                case O:
-                    drawSprite(bigPill_tex[bigPill], 8, 8, 0); break;   // Draw big pill of determined size
-                case F:
-                    drawFruit(x,y); break;  // Method to determine which fruit should be drawn at current location
-            }
-            translateMapCoords(0,1);    // Increment Y pos
-        }
-        glPopMatrix();
+    drawBitboard(board.bigPills, bigPill_tex[bigPill], 8);  // Draw big pill of determined size
 
-        translateMapCoords(1,0);        // Increment X pos
+    if(board.fruitX != -1)  // Draw fruit, if any
+    {
+        translateMapCoords(board.fruitX, board.fruitY);
+        translate(-3.0f, -3.0f);   // Account for over-sized sprite (14x14 on 8x8 tile)
+
+        // Determine which fruit sprite to draw from the array based on current fruit consumption count
+        drawSprite(fruits_tex[board.fruits], 14, 14, 0);
     }
-    glPopMatrix();
+
+    popTranslation();
 }
+#endif //PACMAN_HEADLESS
 
 #endif //PACMAN_MAP_H
@@ -0,0 +1,496 @@
+/**
+ * Header file responsible for the Monte Carlo Tree Search autoplayer - a bot steering Pac-Man by searching ahead
+ * through copies of the game, stepped by the real game logic
+ *
+ * Pac-Man only has a choice to make at the center of a junction tile (or when standing still) - along a corridor he
+ * can only carry on, or follow its corner. The tree therefore branches only at junctions: each node is a junction
+ * reached, and each edge a direction taken from it, followed along the corridors beyond until the next junction.
+ * The game is deterministic given its state, so nodes hold no state - each iteration copies the game at the root and
+ * steps it down the tree, then plays a rollout on from the leaf, picking random directions at junctions, until it
+ * has looked MCTS_HORIZON ticks of play ahead of the root, Pac-Man dies or the level is cleared.
+ *
+ * Searches are tree parallel: every thread descends the same tree, whose visit counts and rewards are atomic. A thread
+ * descending through a node adds MCTS_VIRTUAL_LOSS visits to it without reward, steering the other threads towards
+ * other branches until its rollout is backed up. The thread deciding searches alongside the bot's worker threads,
+ * which are started by its first search and wait between searches to be woken for the next.
+ *
+ * Copies of the game are stepped with instrumentation off (see profile.h), so searching neither races on the profile
+ * nor fills the trace and HUD with ticks that were never played.
+ */
+
+#ifndef PACMAN_MCTS_H
+#define PACMAN_MCTS_H
+
+const int MCTS_NODES = 1 << 16;             // Nodes each search may grow, beyond which leaves are no longer expanded
+const int MCTS_DEPTH = 256;                 // Deepest path through the tree, far deeper than the horizon reaches
+const int MCTS_HORIZON = 150;               // Ticks of play each iteration looks ahead of the root
+const int MCTS_VIRTUAL_LOSS = 3;            // Visits added to a node while a thread's iteration through it is in flight
+const double MCTS_EXPLORATION = 0.5;        // Weight of exploration against exploitation in choosing a branch
+const double MCTS_REWARD_SCORE = 200;       // Score gained at which a surviving rollout earns half of the score reward
+const int MCTS_PILL_RANGE = 40;             // Tiles from a pill beyond which being nearer it is worth nothing
+const long long MCTS_FIXED = 1 << 20;       // Fixed point scale of the rewards summed in each node
+
+// Outcome of looking ahead
+enum mctsOutcome {MCTS_ALIVE, MCTS_DIED, MCTS_CLEARED};
+
+// A junction reached in the search, and the visits and rewards of the iterations through it
+struct MctsNode
+{
+    atomic<int> visits;
+    atomic<long long> value;            // Sum of the rewards backed up through the node, in MCTS_FIXED units
+    atomic<int> children[4];            // Node reached by taking each direction from UP to LEFT, or -1 if not yet expanded
+};
+
+struct MctsConfig
+{
+    int threads;        // Threads searching each decision, fixed once the bot has made its first search
+    double budget;      // Milliseconds each decision may search for
+    long long rollouts; // Rollouts played per decision in place of the budget, or 0 to search for the budget instead
+    uint64_t seed;      // Seed of the rollouts' random choices
+
+    MctsConfig()
+    {
+        threads = 1;
+        budget = 10;
+        rollouts = 0;
+        seed = 0;
+    }
+};
+
+// Too large to be held on the stack - must be held in static or heap storage
+struct MctsBot
+{
+    MctsConfig config;
+    MctsNode nodes[MCTS_NODES];     // Tree of the current search, node 0 being the root
+    atomic<int> nodeCount;          // Nodes grown by the current search
+    long long decisions;            // Searches made
+    long long rollouts;             // Rollouts played across every search
+    long long nodesGrown;           // Nodes grown across every search
+    double seconds;                 // Time spent searching
+
+    // The current search, shared with the worker threads
+    const GameState* root;                  // Game at the root of the search
+    steady_clock::time_point deadline;      // Time at which the search ends, unless playing a fixed number of rollouts
+    atomic<long long> started;              // Rollouts started by the search
+    atomic<long long> played;               // Rollouts played by the search
+
+    vector<thread> workers;                 // Threads searching alongside the thread deciding, config.threads - 1
+    mutex lock;                             // Guards the fields below
+    condition_variable wake;                // Signalled as a search starts, or as the workers are stopped
+    condition_variable finished;            // Signalled as a worker finishes its part of a search
+    long long generation;                   // Searches started, by which a worker tells a search is new
+    int running;                            // Workers yet to finish their part of the current search
+    bool stopping;                          // True once the workers are to exit
+
+    MctsBot() : nodeCount(0), started(0), played(0)
+    {
+        decisions = 0;
+        rollouts = 0;
+        nodesGrown = 0;
+        seconds = 0;
+        root = NULL;
+        generation = 0;
+        running = 0;
+        stopping = false;
+    }
+
+    /**
+     * Stop the worker threads and wait for them to exit - never called during a search, which returns only once
+     * every worker has finished its part
+     */
+    ~MctsBot()
+    {
+        {
+            lock_guard<mutex> guard(lock);
+            stopping = true;
+        }
+        wake.notify_all();
+        for(size_t t = 0; t < workers.size(); t++)
+            workers[t].join();
+    }
+};
+
+/**
+ * @param d - direction of movement
+ * @return -  direction opposite d, or NONE if d=NONE
+ */
+direction oppositeDirection(direction d)
+{
+    return d == NONE ? NONE : static_cast<direction>((d - UP + 2) % 4 + UP);
+}
+
+/**
+ * Get the exits of the tile Pac-Man is on
+ *
+ * @param game - game in play
+ * @return -     exit flags of Pac-Man's tile
+ */
+uint8_t pacmanExits(GameState& game)
+{
+    return getExits(game.pacman.getX(), game.pacman.getY());
+}
+
+/**
+ * Determine whether Pac-Man has a choice of direction to make before the coming tick - at the center of a junction
+ * tile, or when standing still - while the game is in play
+ *
+ * @param game - game in play
+ * @return -     true if a direction must be chosen
+ */
+bool atDecision(GameState& game)
+{
+    if(game.mode != PLAY || game.timestamp != -1)
+        return false;
+    Pacman& pacman = game.pacman;
+    return pacman.getDirection() == NONE || (pacman.atTileCenter() && (pacmanExits(game) & JUNCTION));
+}
+
+/**
+ * Get the direction to take to follow the corridor Pac-Man is in around its corner, if he is at the center of the
+ * corner's tile and would otherwise stop
+ *
+ * @param game - game in play
+ * @return -     direction to turn in, or NONE if Pac-Man can carry on as he is
+ */
+direction corridorTurn(GameState& game)
+{
+    Pacman& pacman = game.pacman;
+    if(game.mode != PLAY || !pacman.atTileCenter())
+        return NONE;
+    uint8_t exits = pacmanExits(game);
+    direction dir = pacman.getDirection();
+    if(dir == NONE || canExit(exits, dir))
+        return NONE;
+    for(int d = UP; d <= LEFT; d++)
+    {
+        if(d != oppositeDirection(dir) && canExit(exits, static_cast<direction>(d)))
+            return static_cast<direction>(d);
+    }
+    return NONE;
+}
+
+/**
+ * Determine the outcome of looking ahead so far - once Pac-Man dies or clears the level, the game pauses in PLAY mode
+ *
+ * @param game - game looked ahead in
+ * @return -     outcome so far
+ */
+mctsOutcome lookaheadOutcome(GameState& game)
+{
+    if(game.mode != PLAY || game.timestamp == -1)
+        return MCTS_ALIVE;
+    return pillsLeft(game.board) == 0 ? MCTS_CLEARED : MCTS_DIED;
+}
+
+/**
+ * Take a direction from a decision, stepping the game on along the corridors beyond until the next decision, the
+ * horizon or the end of the lookahead
+ *
+ * @param game -   game looked ahead in, at a decision
+ * @param d -      direction to take
+ * @param played - ticks of play looked ahead so far, increased by the ticks stepped
+ * @return -       outcome so far
+ */
+mctsOutcome advance(GameState& game, direction d, int& played)
+{
+    game.pacman.setDirection(d);
+    while(true)
+    {
+        stepGame(game);
+        if(game.mode == PLAY)
+            played++;
+        mctsOutcome outcome = lookaheadOutcome(game);
+        if(outcome != MCTS_ALIVE || played >= MCTS_HORIZON || atDecision(game))
+            return outcome;
+        direction turn = corridorTurn(game);
+        if(turn != NONE)
+            game.pacman.setDirection(turn);
+    }
+}
+
+/**
+ * Score the end of a lookahead from 0 to 1: dying scores least, the later the better; surviving scores more the more
+ * score was gained, with a little more for ending near a pill; clearing the level scores most
+ *
+ * @param game -      game looked ahead in
+ * @param outcome -   outcome of the lookahead
+ * @param played -    ticks of play looked ahead
+ * @param rootScore - score at the root of the search
+ * @return -          reward of the lookahead
+ */
+double lookaheadReward(GameState& game, mctsOutcome outcome, int played, int rootScore)
+{
+    if(outcome == MCTS_CLEARED)
+        return 1;
+    if(outcome == MCTS_DIED)
+        return 0.25 * played / MCTS_HORIZON;
+
+    int nearest = MCTS_PILL_RANGE;
+    Point p = {game.pacman.getX(), game.pacman.getY()};
+    for(int x = 0; x < 28; x++)
+    {
+        for(int y = 0; y < 31; y++)
+        {
+            if(game.board.pills.test(x, y) || game.board.bigPills.test(x, y))
+            {
+                int distance = mazeDistance(p, {x, y});
+                if(distance != NO_PATH)
+                    nearest = min(nearest, distance);
+            }
+        }
+    }
+    double gain = game.score - rootScore;
+    return 0.5 + 0.4 * gain / (gain + MCTS_REWARD_SCORE) + 0.1 * (MCTS_PILL_RANGE - nearest) / MCTS_PILL_RANGE;
+}
+
+/**
+ * Prepare a node to be grown into the tree
+ *
+ * @param node - node to prepare
+ */
+void resetNode(MctsNode& node)
+{
+    node.visits = 0;
+    node.value = 0;
+    for(int a = 0; a < 4; a++)
+        node.children[a] = -1;
+}
+
+/**
+ * Choose the direction to take from a node: any direction not yet expanded, in random order, then the direction
+ * whose child has the greatest upper confidence bound
+ *
+ * @param bot -   bot searching
+ * @param node -  node at which to choose
+ * @param exits - exit flags of Pac-Man's tile at the node
+ * @param rng -   random number generator of the searching thread
+ * @return -      direction chosen
+ */
+direction chooseBranch(MctsBot& bot, MctsNode& node, uint8_t exits, Rng& rng)
+{
+    direction unexpanded[4];
+    int unexpandedCount = 0;
+    direction best = NONE;
+    double bestBound = -1;
+    double logVisits = log((double)max(node.visits.load(), 1));
+    for(int d = UP; d <= LEFT; d++)
+    {
+        if(!canExit(exits, static_cast<direction>(d)))
+            continue;
+        int child = node.children[d - UP];
+        if(child == -1)
+        {
+            unexpanded[unexpandedCount++] = static_cast<direction>(d);
+            continue;
+        }
+        int visits = max(bot.nodes[child].visits.load(), 1);
+        double bound = (double)bot.nodes[child].value / MCTS_FIXED / visits + MCTS_EXPLORATION * sqrt(logVisits / visits);
+        if(bound > bestBound)
+        {
+            best = static_cast<direction>(d);
+            bestBound = bound;
+        }
+    }
+    return unexpandedCount > 0 ? unexpanded[rng.nextInt(unexpandedCount)] : best;
+}
+
+/**
+ * Play a single iteration of the search: descend the tree from the root, expand a leaf, roll out from it and back
+ * its reward up the path taken
+ *
+ * @param bot -  bot searching
+ * @param root - game at the root of the search
+ * @param rng -  random number generator of the searching thread
+ */
+void iterate(MctsBot& bot, const GameState& root, Rng& rng)
+{
+    int path[MCTS_DEPTH];
+    int depth = 0;
+    path[depth++] = 0;
+    bot.nodes[0].visits += MCTS_VIRTUAL_LOSS;
+
+    GameState game = root;
+    int played = 0;
+    mctsOutcome outcome = MCTS_ALIVE;
+    bool expanded = false;
+
+    // Descend the tree, expanding the first node not yet in it
+    while(outcome == MCTS_ALIVE && played < MCTS_HORIZON && !expanded && depth < MCTS_DEPTH)
+    {
+        MctsNode& node = bot.nodes[path[depth - 1]];
+        direction d = chooseBranch(bot, node, pacmanExits(game), rng);
+        if(d == NONE)
+            break;
+        int child = node.children[d - UP];
+        if(child == -1)
+        {
+            int grown = bot.nodeCount++;
+            if(grown >= MCTS_NODES)     // Out of nodes - roll out from here instead
+                break;
+            resetNode(bot.nodes[grown]);
+            child = -1;
+            if(node.children[d - UP].compare_exchange_strong(child, grown))
+                child = grown;          // Otherwise another thread expanded it first, and the node grown goes unused
+            expanded = true;
+        }
+        bot.nodes[child].visits += MCTS_VIRTUAL_LOSS;
+        path[depth++] = child;
+        outcome = advance(game, d, played);
+    }
+
+    // Roll out, taking a random direction at each junction - but never straight back the way Pac-Man came
+    while(outcome == MCTS_ALIVE && played < MCTS_HORIZON)
+    {
+        uint8_t exits = pacmanExits(game);
+        direction options[4];
+        int count = 0;
+        for(int d = UP; d <= LEFT; d++)
+        {
+            if(canExit(exits, static_cast<direction>(d)) && d != oppositeDirection(game.pacman.getDirection()))
+                options[count++] = static_cast<direction>(d);
+        }
+        if(count == 0)
+            options[count++] = oppositeDirection(game.pacman.getDirection());
+        outcome = advance(game, options[rng.nextInt(count)], played);
+    }
+
+    // Back the reward up, replacing each virtual loss with a single visit
+    long long reward = (long long)(lookaheadReward(game, outcome, played, root.score) * MCTS_FIXED);
+    for(int i = 0; i < depth; i++)
+    {
+        bot.nodes[path[i]].visits -= MCTS_VIRTUAL_LOSS - 1;
+        bot.nodes[path[i]].value += reward;
+    }
+}
+
+/**
+ * Play iterations of the current search on a single thread until its budget is spent
+ *
+ * @param bot - bot searching
+ * @param t -   index of the thread, 0 being the thread deciding
+ */
+void searchThread(MctsBot& bot, int t)
+{
+    // Every thread draws from its own stream, derived from the seed and the decision
+    Rng rng(bot.config.seed ^ ((uint64_t)bot.decisions << 8 | t) * 0x9E3779B97F4A7C15ULL);
+    while((bot.config.rollouts == 0 || bot.started++ < bot.config.rollouts) &&
+          (bot.config.rollouts > 0 || steady_clock::now() < bot.deadline))
+    {
+        iterate(bot, *bot.root, rng);
+        bot.played++;
+    }
+}
+
+/**
+ * Run one of the bot's worker threads, which only ever steps copies of the game: wait for each search to start, and
+ * search alongside the thread deciding until it ends, until the bot is destroyed
+ *
+ * @param bot - bot searching
+ * @param t -   index of the thread, from 1
+ */
+void searchWorker(MctsBot& bot, int t)
+{
+    instrumented = false;
+    long long searched = 0;     // Generation of the last search taken part in
+    while(true)
+    {
+        {
+            unique_lock<mutex> guard(bot.lock);
+            bot.wake.wait(guard, [&]() { return bot.stopping || bot.generation != searched; });
+            if(bot.stopping)
+                return;
+            searched = bot.generation;
+        }
+        searchThread(bot, t);
+
+        lock_guard<mutex> guard(bot.lock);
+        if(--bot.running == 0)
+            bot.finished.notify_one();
+    }
+}
+
+/**
+ * Search for the direction to take at a decision, on every thread of the bot, until its budget is spent
+ *
+ * @param bot -  bot searching
+ * @param game - game at the decision
+ * @return -     direction whose branch was visited most
+ */
+direction search(MctsBot& bot, const GameState& game)
+{
+    steady_clock::time_point start = steady_clock::now();
+    resetNode(bot.nodes[0]);
+    bot.nodeCount = 1;
+    bot.root = &game;
+    bot.deadline = start + duration_cast<steady_clock::duration>(duration<double, milli>(bot.config.budget));
+    bot.started = 0;
+    bot.played = 0;
+
+    if(bot.workers.empty())
+    {
+        for(int t = 1; t < bot.config.threads; t++)
+            bot.workers.push_back(thread([&bot, t]() { searchWorker(bot, t); }));
+    }
+    {
+        lock_guard<mutex> guard(bot.lock);
+        bot.generation++;
+        bot.running = bot.workers.size();
+    }
+    bot.wake.notify_all();
+
+    bool wasInstrumented = instrumented;    // The thread deciding steps the game itself between searches
+    instrumented = false;
+    searchThread(bot, 0);
+    instrumented = wasInstrumented;
+    {
+        unique_lock<mutex> guard(bot.lock);
+        bot.finished.wait(guard, [&]() { return bot.running == 0; });
+    }
+
+    direction best = NONE;
+    int mostVisits = -1;
+    for(int d = UP; d <= LEFT; d++)
+    {
+        int child = bot.nodes[0].children[d - UP];
+        if(child != -1 && bot.nodes[child].visits > mostVisits)
+        {
+            best = static_cast<direction>(d);
+            mostVisits = bot.nodes[child].visits;
+        }
+    }
+
+    bot.decisions++;
+    bot.rollouts += bot.played;
+    bot.nodesGrown += min(bot.nodeCount.load(), MCTS_NODES);
+    bot.seconds += duration<double>(steady_clock::now() - start).count();
+    return best;
+}
+
+/**
+ * Decide how to steer Pac-Man for the coming tick - searching at decisions, and following corridors between them
+ *
+ * @param bot -  bot steering Pac-Man
+ * @param game - game in play
+ * @return -     direction in which to steer Pac-Man, or NONE to leave him as he is
+ */
+direction mctsDecide(MctsBot& bot, GameState& game)
+{
+    if(atDecision(game))
+        return search(bot, game);
+    return corridorTurn(game);
+}
+
+/**
+ * Print the work done by the bot's searches
+ *
+ * @param bot - bot
+ */
+void printMctsStats(const MctsBot& bot)
+{
+    printf("decisions:  %lld\n", bot.decisions);
+    printf("rollouts:   %.0f per decision\n", (double)bot.rollouts / max(bot.decisions, 1LL));
+    printf("nodes:      %.0f per decision\n", (double)bot.nodesGrown / max(bot.decisions, 1LL));
+    printf("rollouts/s: %.0f\n", bot.rollouts / max(bot.seconds, 1e-9));
+}
+
+#endif //PACMAN_MCTS_H
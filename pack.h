@@ -0,0 +1,168 @@
+/**
+ * Header file responsible for the sprite pack format, holding every sprite pre-decoded and packed into atlas pages
+ *
+ * A pack is built offline by spritepack (see spritepack.cpp) and laid out as:
+ *      Header:  magic, version, flags, page size and the number of pages and sprites
+ *      Index:   one entry per sprite - its PNG file name and its place within the pages
+ *      Pages:   RGBA pixels of every page, row by row from the bottom, starting on a PACK_ALIGNMENT boundary
+ * The game maps the whole file into memory and hands the pages straight to GL, with no decoding and no copies.
+ * All values are stored in the byte order of the machine that built the pack.
+ */
+
+#ifndef PACMAN_PACK_H
+#define PACMAN_PACK_H
+
+const char PACK_MAGIC[4] = {'P', 'M', 'S', 'P'};
+const uint32_t PACK_VERSION = 1;
+const uint32_t PACK_PREMULTIPLIED = 1;  // Flag set when colours are pre-multiplied by alpha
+const int PACK_NAME_LENGTH = 64;        // Longest file name stored, including its terminating null
+const uint64_t PACK_ALIGNMENT = 4096;   // Alignment of the pages within the file
+
+struct PackHeader
+{
+    char magic[4];          // PACK_MAGIC
+    uint32_t version;       // PACK_VERSION
+    uint32_t flags;         // PACK_PREMULTIPLIED, or 0
+    uint32_t pageSize;      // Width and height of each page, in pixels
+    uint32_t pageCount;     // Number of pages
+    uint32_t spriteCount;   // Number of index entries, directly following the header
+    uint64_t pagesOffset;   // Offset of the first page from the start of the file
+};
+
+struct PackEntry
+{
+    char name[PACK_NAME_LENGTH];    // PNG file the sprite was built from, as registered by the game
+    int32_t page;                   // Page holding the sprite
+    int32_t x, y;                   // Bottom left corner of the sprite within its page, in pixels
+    int32_t width, height;          // Size of the sprite, in pixels
+};
+
+// A pack opened for reading, mapped into memory where possible
+struct Pack
+{
+    unsigned char* data;        // Whole contents of the file
+    size_t size;                // Size of the file, in bytes
+    const PackHeader* header;
+    const PackEntry* entries;
+};
+
+/**
+ * Get the size in bytes of one page of a pack
+ *
+ * @param header - header of the pack
+ * @return -       size of a page
+ */
+uint64_t packPageBytes(const PackHeader& header)
+{
+    return (uint64_t)header.pageSize * header.pageSize * 4;
+}
+
+/**
+ * Close a pack opened by openPack(), releasing its memory
+ *
+ * @param pack - pack to close
+ */
+void closePack(Pack& pack)
+{
+    if(pack.data != NULL)
+    {
+#ifdef _WIN32
+        free(pack.data);
+#else
+        munmap(pack.data, pack.size);
+#endif
+    }
+    pack.data = NULL;
+    pack.size = 0;
+}
+
+/**
+ * Open a pack, mapping the file into memory (or, on Windows, reading it in whole) and checking its layout
+ *
+ * @param filename - file to open
+ * @param pack -     set to the opened pack
+ * @return -         false if the file is missing, or is not a complete pack of this version
+ */
+bool openPack(const char* filename, Pack& pack)
+{
+    pack.data = NULL;
+    pack.size = 0;
+
+#ifdef _WIN32
+    FILE* file = fopen(filename, "rb");
+    if(file == NULL)
+        return false;
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    if(size > 0)
+    {
+        pack.data = (unsigned char*)malloc(size);
+        pack.size = size;
+        if(pack.data != NULL && fread(pack.data, 1, size, file) != (size_t)size)
+            closePack(pack);
+    }
+    fclose(file);
+#else
+    int file = open(filename, O_RDONLY);
+    if(file == -1)
+        return false;
+    struct stat info;
+    if(fstat(file, &info) == 0 && info.st_size > 0)
+    {
+        void* data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+        if(data != MAP_FAILED)
+        {
+            pack.data = (unsigned char*)data;
+            pack.size = info.st_size;
+        }
+    }
+    close(file);    // The mapping outlives the file descriptor
+#endif
+    if(pack.data == NULL)
+        return false;
+
+    // Check the header, then that the index and every page lie within the file
+    pack.header = (const PackHeader*)pack.data;
+    pack.entries = (const PackEntry*)(pack.data + sizeof(PackHeader));
+    if(pack.size < sizeof(PackHeader) || memcmp(pack.header->magic, PACK_MAGIC, 4) != 0 ||
+       pack.header->version != PACK_VERSION ||
+       sizeof(PackHeader) + (uint64_t)pack.header->spriteCount * sizeof(PackEntry) > pack.header->pagesOffset ||
+       pack.header->pagesOffset + pack.header->pageCount * packPageBytes(*pack.header) > pack.size)
+    {
+        closePack(pack);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Get the pixels of a page of an open pack
+ *
+ * @param pack - open pack
+ * @param page - index of the page
+ * @return -     RGBA pixels of the page
+ */
+const unsigned char* packPage(const Pack& pack, int page)
+{
+    return pack.data + pack.header->pagesOffset + page * packPageBytes(*pack.header);
+}
+
+/**
+ * Find the index entry of a sprite within an open pack
+ *
+ * @param pack - open pack
+ * @param name - PNG file the sprite was built from
+ * @return -     entry of the sprite, or NULL if the pack lacks it
+ */
+const PackEntry* findPackEntry(const Pack& pack, const char* name)
+{
+    for(uint32_t i = 0; i < pack.header->spriteCount; i++)
+    {
+        if(strncmp(pack.entries[i].name, name, PACK_NAME_LENGTH) == 0)
+            return &pack.entries[i];
+    }
+    return NULL;
+}
+
+#endif //PACMAN_PACK_H
@@ -5,139 +5,204 @@
 #ifdef __APPLE__
 #include <GLUT/glut.h>
 #else
-#include <GL/glut.h>
+#include <GL/freeglut.h>  // freeglut extensions provide glutGetProcAddress
 #endif
 
 #include <stddef.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <limits.h>
 #include <string.h>
 #include <cmath>
+#include <algorithm>
 #include <iostream>
 #include <png.h>
 #include <vector>
 #include <fstream>
 #include <chrono>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <type_traits>
+#include <functional>
 #include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#endif
 using namespace std;    // No need to write std::-bla all the time
 using namespace std::chrono;    // No need to write std::chrono::-bla all the time
 
 // Lab header files
 #include "png_load.h"
-#include "load_and_bind_texture.h"
 
 // Custom header files
 #include "types.h"
+#include "rng.h"
+#include "profile.h"
+#include "trace.h"
+#include "perf.h"
+#include "atlas.h"
+#include "pack.h"
 #include "textures.h"
 #include "map.h"
+#include "paths.h"
+#include "input.h"
 #include "ui.h"
 #include "pacman.h"
 #include "ghosts.h"
 #include "globals.h"
+#include "replay.h"
+#include "savestate.h"
+#include "rewind.h"
+#include "mcts.h"
+
+// State of the game being played in the window
+GameState game;
+uint64_t seed;                  // Seed the game was started from
+
+Replay replay;                  // Replay being recorded or played back
+const char* recordFile = NULL;  // File to which to write the replay being recorded as the game exits, if any
+bool replaying = false;         // True if playing back a replay in place of live input
+size_t nextAction = 0;          // Index of the next action of the replay to play back
+
+Rewind history;                 // History of the last few minutes of the game
+bool rewinding = false;         // True while scrubbing through the history, with the game held at the state shown
+long long rewindPosition;       // Position within the history of the state shown while scrubbing
+const int REWIND_STEP = 30;     // States scrubbed through by a single press of Up or Down - a second of play
+
+MctsBot* autoplayer = NULL;         // Bot steering Pac-Man in place of the arrow keys, if autoplaying
+const double AUTOPLAY_BUDGET = 5;   // Milliseconds the bot may search each decision for, well within a tick
+
+/**
+ * The game logic runs at a fixed rate of 30 ticks per second, helping to ensure the game plays identically across all
+ * systems, while frames are drawn as often as the display allows.
+ *
+ * Real time passed, measured by a monotonic clock, is banked in an accumulator and spent on whole ticks. A slow frame
+ * is caught up on with several ticks before the next frame is drawn, up to a limit per frame - any further backlog is
+ * caught up on over the following frames, and only a stall of more than a few ticks is dropped rather than repaid.
+ * Between ticks, Pac-Man & Ghosts are drawn part way between their last two positions, so they move smoothly at any
+ * frame rate.
+ */
+const steady_clock::duration TICK_LENGTH = duration_cast<steady_clock::duration>(duration<double>(1.0 / 30));
+const int MAX_TICKS_PER_FRAME = 4;      // Most ticks run before a frame is drawn, and most the backlog may hold after
+const int MAX_FRAME_RATE = 240;         // Cap on frames drawn per second, should the display not limit them already
+const steady_clock::duration MIN_FRAME_LENGTH = duration_cast<steady_clock::duration>(duration<double>(1.0 / MAX_FRAME_RATE));
+
+steady_clock::time_point lastFrame;             // Time at which the last frame began
+steady_clock::duration accumulator(0);          // Real time passed that has not yet been spent on ticks
+CharacterPositions previousPositions;           // Positions of the characters before the latest tick
+long long ticksRun = 0;                         // Ticks run since the game was launched
 
 /**
- * Time stamping frames under the guise of a fixed frame rate helps to ensure the game plays similarly across all systems
- * On my laptop, for example, the idle loop was able to iterate much more quickly than my desktop
- * This resulted in a wildly different game experience
+ * Apply an action made by live input to the game, recording it if a replay is being recorded
  *
- * By using a fixed frame rate, the game loop can only iterate slower than a fixed rate (30fps)
- * This prevents high-performance systems rendering frames more quickly than the player can comprehend them
+ * @param act - action made
  */
-float frameLength = 1000/30;    // Length of a single frame in ms (30fps)
-milliseconds last;      // Init last frame time
-milliseconds now;       // Init current frame time
+void act(action act)
+{
+    applyAction(game, act);
+    if(recordFile != NULL)
+        recordAction(replay, ticksRun, act);
+}
 
 /**
- * Compute all game logic prior to redrawing anything
- * Logic to compute varies on gamemode
+ * Write out the replay being recorded, as the game exits
+ */
+void saveReplay()
+{
+    finishReplay(replay, game, ticksRun);
+    if(!writeReplay(recordFile, replay))
+        fprintf(stderr, "Failed to write replay to %s\n", recordFile);
+}
+
+/**
+ * Report the work done by the autoplayer's searches, as the game exits
+ */
+void printAutoplay()
+{
+    printMctsStats(*autoplayer);
+}
+
+/**
+ * Run as many ticks of game logic as the real time passed calls for, then redraw
+ * The logic itself is performed by stepGame() in globals.h
  */
 void gameLoop()
 {
-    // Set current frame time to current time
-    now = duration_cast<milliseconds>(system_clock::now().time_since_epoch());
-    // If the elapsed time since the last frame is less than the frame length, sleep until the frame should be drawn
-    if(float(now.count() - last.count()) < frameLength)
-        usleep((frameLength - (now.count() - last.count())) * 1000);
-    // As current frame is now being rendered, set last frame to current frame for next game loop iteration
-    last = now;
-
-    // Perform certain logic depending on game mode
-    switch(mode)
+    // Sleep off any time left before the next frame may begin, then bank the time passed since the last frame
+    this_thread::sleep_until(lastFrame + MIN_FRAME_LENGTH);
+    steady_clock::time_point now = steady_clock::now();
+    accumulator += now - lastFrame;
+    lastFrame = now;
+    if(rewinding)   // Hold the game at the state shown, running no ticks while scrubbing
+        accumulator = steady_clock::duration::zero();
+
+    // Advance the game by one tick for every tick length banked, up to the limit per frame
+    for(int i = 0; i < MAX_TICKS_PER_FRAME && accumulator >= TICK_LENGTH; i++)
     {
-        case READY:     // After 240 ticks, enter PLAY mode
-            if(ticks > 240)
-                mode = PLAY;
+        // Hold the last frame once a replay being played back has ended
+        if(replaying && ticksRun == replay.header.ticks)
             break;
-        case PLAY:      // Main play loop
-            if(timestamp == -1)         // If timestamp is not set, execute all PLAY-mode logic
-            {
-                checkCollisions();      // Check Pac-Man's collisions with pills and ghosts
-                pacman.move();          // Move Pac-Man
-                checkCollisions();      // Check collisions again to ensure simultaneous tile switches register correct collisions
-                aiWave();               // Update the ghost AI targeting wave
-                // Move each ghost - pass RED ghost for BLUE's CHASE mode AI
-                for(int i = 0; i < 4; i++)
-                    ghosts[i].move(ghosts[0]);
-                // If no fruit is currently spawned, enough pills have been eaten,
-                // The eaten fruit count doesn't exceed the level and a random quantifier is satisfied, spawn a fruit
-                if(!fruitSpawned && fruits < level && pillsLeft <= 240 - 30 &&  rand() % 1500 == 0)
-                    spawnFruit();
-            }
-            else
+
+        // Advance the animations of the characters as drawn since the last tick, before they are moved on
+        if(ticksRun > 0)
+            animateCharacters(game);
+
+        if(replaying)
+        {
+            // Apply every action played back before this tick
+            while(nextAction < replay.actions.size() && replay.actions[nextAction].tick <= ticksRun)
+                applyAction(game, replay.actions[nextAction++].act);
+        }
+        else
+        {
+            // Apply every input queued since the last tick, in the order they were made, if the game is still playable
+            InputEvent input;
+            while(popInput(inputRing, input))
             {
-                if(ticks == timestamp + 90)     // If timestamp is set, incur a short pause
-                {                               // Timestamp is only set in PLAY-mode when Pac-Man dies or level is complete
-                    if(pillsLeft == 0)          // If no pills remain, level is complete
-                    {                           // Reset map & pill count and enter READY-mode for next level
-                        pillsLeft = 244;
-                        level++;
-                        resetMap();
-                        resetLevel();
-                    }
-                    else                        // If there are still pills remaining, Pac-Man has died
-                    {
-                        timestamp = ticks;      // Set timestamp for correct death animation timing
-                        mode = DEATH;           // Enter DEATH-mode
-                    }
+                if(game.mode == PLAY || game.mode == EAT || game.mode == READY)
+                {
+                    act(static_cast<action>(input.dir));
+                    inputApplied(inputLatency, input);
                 }
             }
-            break;
-        case FRUIT:     // Pause the game briefly on eating a fruit
-        case EAT:       // Also pause on eating a ghost - logical behaviour is identical so overflow switch case
-            if(ticks == timestamp + 90)
+            if(autoplayer != NULL)
             {
-                timestamp = -1;
-                pacman.startChomping();
-                mode = PLAY;
-            }
-            break;
-        case DEATH:     // 180 ticks after death, enter READY (reset level) or GAMEOVER mode depending on remaining lives
-            if(ticks > timestamp + 180)
-            {
-                if(lives == 0)
-                {
-                    mode = GAMEOVER;
-                    if(score > highscore)
-                    {
-                        highscore = score;
-                        setHighscore();
-                    }
-                }
-                else
-                {
-                    lives--;        // Decrease remaining lives on death
-                    resetFruit();   // Remove any spawned fruits
-                    resetLevel();   // Reset characters and variables to retry level
-                }
+                direction d = mctsDecide(*autoplayer, game);
+                if(d != NONE)
+                    act(static_cast<action>(d));
             }
-            break;
+        }
+
+#ifdef PACMAN_PROFILE
+        steady_clock::time_point tickStart = steady_clock::now();
+#endif
+        previousPositions = savePositions(game);
+        stepGame(game);
+        recordRewind(history, game);
+        ticksRun++;
+        accumulator -= TICK_LENGTH;
+#ifdef PACMAN_PROFILE
+        endProfileTick(steady_clock::now() - tickStart);
+#endif
+
+        // Save the high score as soon as the game is over, unless only replaying a game
+        if(game.mode == GAMEOVER && game.score > highscore && !replaying)
+        {
+            highscore = game.score;
+            setHighscore();
+        }
     }
+    accumulator = min(accumulator, TICK_LENGTH * MAX_TICKS_PER_FRAME);
 
     // Draw the current frame
     glutPostRedisplay();
-
-    // Increment game ticks once the frame is drawn, but only if not paused
-    if(mode != PAUSE)
-        ticks++;
 }
 
 /**
@@ -146,103 +211,204 @@ void gameLoop()
  */
 void display()
 {
+    TRACE_SPAN("frame");
+
     glClear(GL_COLOR_BUFFER_BIT);   // Clear display buffer colour
     glMatrixMode(GL_MODELVIEW);     // Set matrix mode - no further projection is required in this 2D game
     glLoadIdentity();
+    beginSprites();
+
+    // Fraction of the way from the previous tick to the next at which to draw moving characters
+    float alpha = min(duration<float>(accumulator) / duration<float>(TICK_LENGTH), 1.0f);
 
     // Draw specific items pertaining to current gamemode
-    switch(mode)
+    switch(game.mode)
     {
         case READY:
-            drawPlayScreen();
-            drawCharacters();
+            drawPlayScreen(game);
+            drawCharacters(game, previousPositions, alpha);
             drawReady();
             break;
         case PLAY:
-            drawPlayScreen();
-            drawCharacters();
+            drawPlayScreen(game);
+            drawCharacters(game, previousPositions, alpha);
             break;
         case FRUIT:
-            drawPlayScreen();
+            drawPlayScreen(game);
             for(int i = 0; i < 4; i++)
-                ghosts[i].draw();
-            pacman.drawFruitScore();
+                game.ghosts[i].draw();
+            game.pacman.drawFruitScore(game.board.fruits);
             break;
         case EAT:
-            drawPlayScreen();
+            drawPlayScreen(game);
             for(int i = 0; i < 4; i++)
-                ghosts[i].drawEaten();
+                game.ghosts[i].drawEaten(game.ghostsEaten);
             break;
         case PAUSE:
-            drawPause(tempMode == GAMEOVER);
-            drawLevel();
-            drawScore();
-            drawLives();
-            drawFruits();
+            drawPause(game.tempMode == GAMEOVER);
+            drawLevel(game.level);
+            drawScore(game.score);
+            drawLives(game.lives);
+            drawFruits(game.board.fruits);
             drawQuit();
             break;
         case DEATH:
-            drawPlayScreen();
-            pacman.drawDead();
+            drawPlayScreen(game);
+            game.pacman.drawDead();
             break;
         case GAMEOVER:
-            drawPlayScreen();
+            drawPlayScreen(game);
             drawGameover();
             break;
     }
 
+    flushSprites();     // Draw any sprites still queued
+    if(rewinding)
+        drawRewind((history.end - 1 - rewindPosition) / 30.0f,
+                   (float)(rewindPosition - history.start) / max(rewindLength(history) - 1, 1LL));
+#ifdef PACMAN_PROFILE
+    drawProfile();      // Draw the profiling HUD over the frame, if shown
+    {
+        PHASE(PHASE_SWAP);
+        glutSwapBuffers();
+    }
+    endProfileFrame();
+#else
     glutSwapBuffers();
+#endif
+    framePresented(inputLatency, steady_clock::now());  // Measure the latency of the inputs applied since the last frame
 }
 
 
 /**
  * Keyboard input handlers for all user input
  *      keyboard() - handle normal key input (ie. letters, space bar, ESC key, etc.)
- *      special() -  handle special key input (ie. arrow keys, etc.)
+ *      special() -  handle special key input (ie. arrow keys, etc.) - directions are queued for the next tick
  *
  * @param key - key pressed by user
  */
 void keyboard(unsigned char key, int, int) {
+    PHASE(PHASE_INPUT);
+
+    if(rewinding)   // Only allow quitting, besides the keys scrubbing through the history, while rewinding
+    {
+        if(key == 27)
+            exit(1);
+        return;
+    }
+    if(replaying)   // Only allow quitting while a replay is played back
+    {
+        if(key == 27)
+            exit(1);
+        return;
+    }
+
     switch (key) {
         case 27:    // Escape Key pauses/quits game
-            if(mode != PAUSE)
-            {
-                tempMode = mode;    // Save gamemode to re-enter on unpausing game
-                mode = PAUSE;
-            }
-            else if(mode == PAUSE)
+            if(game.mode != PAUSE)
+                act(ACTION_PAUSE);  // Save gamemode to re-enter on unpausing game
+            else if(game.mode == PAUSE)
                 exit(1);
             break;
         default:    // For any other key, unpause if mode=PAUSE or restart game if mode=GAMEOVER
-            if(mode == PAUSE && tempMode != GAMEOVER)
-                mode = tempMode;
-            else if(mode == GAMEOVER || mode == PAUSE)
-                restartGame();
+            if(game.mode == PAUSE && game.tempMode != GAMEOVER)
+                act(ACTION_RESUME);
+            else if(game.mode == GAMEOVER || game.mode == PAUSE)
+                act(ACTION_RESTART);
             break;
     }
 }
 void special(int key, int, int)
 {
-    // Update Pac-Man's direction, pause/unpause or restart game depending on game mode
-    if(mode == PLAY || mode == EAT || mode == READY)    // Update direction if game is currently playable
+    PHASE(PHASE_INPUT);
+
+#ifdef PACMAN_PROFILE
+    if(key == GLUT_KEY_F3)      // F3 shows/hides the profiling HUD, in any game mode
+    {
+        profile.visible = !profile.visible;
+        return;
+    }
+#endif
+    if(key == GLUT_KEY_F5)      // F5 saves the state of the game to a file, in any game mode
+    {
+        Snapshot snapshot;
+        takeSnapshot(game, snapshot);
+        if(!writeSaveState(SAVESTATE_FILE, snapshot))
+            fprintf(stderr, "Failed to write save state to %s\n", SAVESTATE_FILE);
+        return;
+    }
+    if(replaying)
+        return;
+    if(key == GLUT_KEY_F6)      // F6 starts scrubbing through the history, or resumes play from the state shown
+    {
+        if(recordFile != NULL)
+            fprintf(stderr, "The game cannot be rewound while recording a replay\n");
+        else if(!rewinding)
+        {
+            rewinding = true;
+            rewindPosition = history.end - 1;
+        }
+        else
+        {
+            truncateRewind(history, rewindPosition);    // The states after the one shown are played afresh
+            rewinding = false;
+        }
+        return;
+    }
+    if(rewinding)
+    {
+        // Scrub a state at a time with Left and Right, or a second at a time with Down and Up
+        long long position = rewindPosition;
+        switch(key)
+        {
+            case GLUT_KEY_LEFT:     position--;                 break;
+            case GLUT_KEY_RIGHT:    position++;                 break;
+            case GLUT_KEY_DOWN:     position -= REWIND_STEP;    break;
+            case GLUT_KEY_UP:       position += REWIND_STEP;    break;
+        }
+        rewindPosition = min(max(position, history.start), history.end - 1);
+        seekRewind(history, rewindPosition, game);
+        previousPositions = savePositions(game);    // Draw the characters where scrubbed to, rather than moving there
+        return;
+    }
+    if(key == GLUT_KEY_F9)      // F9 loads the saved state, unless recording a replay, which could no longer be played back
     {
+        Snapshot snapshot;
+        if(recordFile != NULL)
+            fprintf(stderr, "Save states cannot be loaded while recording a replay\n");
+        else if(!readSaveState(SAVESTATE_FILE, snapshot))
+            fprintf(stderr, "Failed to read save state from %s\n", SAVESTATE_FILE);
+        else
+        {
+            restoreSnapshot(game, snapshot);
+            previousPositions = savePositions(game);    // Draw the characters where loaded, rather than moving there
+        }
+        return;
+    }
+
+    // Queue Pac-Man's direction for the next tick, pause/unpause or restart game depending on game mode
+    if(game.mode == PLAY || game.mode == EAT || game.mode == READY) // Update direction if game is currently playable
+    {
+        InputEvent input = {NONE, steady_clock::now()};
         switch (key)
         {
-            case GLUT_KEY_UP:       pacman.setDirection(UP);    break;
-            case GLUT_KEY_RIGHT:    pacman.setDirection(RIGHT); break;
-            case GLUT_KEY_DOWN:     pacman.setDirection(DOWN);  break;
-            case GLUT_KEY_LEFT:     pacman.setDirection(LEFT);  break;
+            case GLUT_KEY_UP:       input.dir = UP;       break;
+            case GLUT_KEY_RIGHT:    input.dir = RIGHT;    break;
+            case GLUT_KEY_DOWN:     input.dir = DOWN;     break;
+            case GLUT_KEY_LEFT:     input.dir = LEFT;     break;
         }
+        if(input.dir != NONE && autoplayer == NULL)    // The autoplayer alone steers Pac-Man while autoplaying
+            pushInput(inputRing, input);
     }
     else
     {
         switch(key)
         {
             default:    // For any special key input, unpause if mode=PAUSE or restart game if mode=GAMEOVER
-                if(mode == PAUSE && tempMode != GAMEOVER)
-                    mode = tempMode;
-                else if(mode == GAMEOVER || mode == PAUSE)
-                    restartGame();
+                if(game.mode == PAUSE && game.tempMode != GAMEOVER)
+                    act(ACTION_RESUME);
+                else if(game.mode == GAMEOVER || game.mode == PAUSE)
+                    act(ACTION_RESTART);
                 break;
         }
     }
@@ -275,19 +441,59 @@ void init()
     gluOrtho2D(0, 300, 0, 300);
     glClearColor(0.0f, 0.0f, 0.0f, 0.0f);   // Set background to black
     loadBindTextures();                     // Load and bind all textures to be used later as sprites
+    initMapLayer();                         // Prepare to cache the map offscreen, if supported
     getHighscore();                         // Retrieve high score from local file, if it exists, otherwise init file with value 0
-    // Init start time for frame rate cap
-    last = duration_cast<milliseconds>(system_clock::now().time_since_epoch());
+    seed = system_clock::now().time_since_epoch().count();  // Seed the game differently on every launch
+    game.rng = Rng(seed);
+    // Init start time for the fixed timestep
+    lastFrame = steady_clock::now();
 }
 
 /**
  * Initialise the program, creating handlers for keyboard input and visibility (minimising the game)
  * Calls the init() method to initialise the world and all textures
- * Enters main loop, starting the game
+ * Enters main loop, starting the game - if built with tracing, the trace is written out as the game exits
+ *
+ * Usage: ./pacman [--turn-window N] [--path-ghosts] [--record FILE] [--autoplay]
+ *        ./pacman --replay FILE
+ *      --turn-window: hold each turn pressed for at most N ticks ahead of the junction at which it is taken
+ *      --path-ghosts: make the ghosts target by path distance through the maze
+ *      --record:      record the session, writing it to FILE as a replay as the game exits
+ *      --replay:      play back a recorded session, with its own options, in place of live input
+ *      --autoplay:    let the MCTS autoplayer (see mcts.h) steer Pac-Man, searching on every core
  */
 int main(int argc, char* argv[])
 {
-    glutInit(&argc, argv);
+    glutInit(&argc, argv);    // Removes any GLUT options, leaving the game's own
+    int turnWindow = 0;
+    bool pathGhosts = false;
+    const char* replayFile = NULL;
+    bool autoplay = false;
+    for(int i = 1; i < argc; i++)
+    {
+        if(strcmp(argv[i], "--turn-window") == 0 && i + 1 < argc)
+            turnWindow = max(atoi(argv[++i]), 0);
+        else if(strcmp(argv[i], "--path-ghosts") == 0)
+            pathGhosts = true;
+        else if(strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+            recordFile = argv[++i];
+        else if(strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+            replayFile = argv[++i];
+        else if(strcmp(argv[i], "--autoplay") == 0)
+            autoplay = true;
+        else
+        {
+            fprintf(stderr, "Usage: %s [--turn-window N] [--path-ghosts] [--record FILE] [--autoplay]\n", argv[0]);
+            fprintf(stderr, "       %s --replay FILE\n", argv[0]);
+            return 1;
+        }
+    }
+    if(replayFile != NULL && !readReplay(replayFile, replay))
+    {
+        fprintf(stderr, "Failed to read replay from %s\n", replayFile);
+        return 1;
+    }
+
     glutInitDisplayMode(GLUT_DOUBLE|GLUT_RGBA);
     glutInitWindowSize(600, 600);
     glutInitWindowPosition(50, 50);
@@ -302,6 +508,36 @@ int main(int argc, char* argv[])
 
     init();
 
+    if(replayFile != NULL)
+    {
+        setupReplay(game, replay);
+        replaying = true;
+        recordFile = NULL;  // A replay is never re-recorded
+    }
+    else
+    {
+        setPathGhosts(game, pathGhosts);
+        setTurnWindow(game, turnWindow);
+        if(recordFile != NULL)
+        {
+            startReplay(replay, seed, pathGhosts, turnWindow);
+            atexit(saveReplay);     // The game only ever ends by exiting
+        }
+        if(autoplay)
+        {
+            autoplayer = new MctsBot();
+            autoplayer->config.threads = max((int)thread::hardware_concurrency(), 1);
+            autoplayer->config.budget = AUTOPLAY_BUDGET;
+            autoplayer->config.seed = seed;
+            atexit(printAutoplay);
+        }
+    }
+    startRewind(history, game);
+
+#ifdef PACMAN_TRACE
+    atexit([]() { writeTrace(TRACE_FILE); });  // The game only ever ends by exiting
+#endif
+
     glutMainLoop();
 
     return 0;
@@ -5,12 +5,6 @@
 #ifndef PACMAN_PACMAN_H
 #define PACMAN_PACMAN_H
 
-// Allow access of ticks, count of remaining pills, number of fruits eaten and fruit spawned flag from globals.h
-extern int ticks;
-extern int pillsLeft;
-extern int fruits;
-extern bool fruitSpawned;
-
 /**
  * For ease of reference and handling Pac-Man, he is defined as an object type
  * All variables are private, not needing to be accessed externally
@@ -20,8 +14,8 @@ class Pacman
 {
 private:
     /// List of private variables which Pac-Man uses
-    float x;                // X position relative to map - float allows for smooth movement between tiles
-    float y;                // Y position relative to map - float allows for smooth movement between tiles
+    int x;                  // X position relative to map, in sub-tile units - allows for smooth movement between tiles
+    int y;                  // Y position relative to map, in sub-tile units - allows for smooth movement between tiles
     float angle;            // Angle at which to draw the sprite - class var to retain angle when dir=NONE
     direction dir;          // Direction of movement
     direction tempDir;      // Temporary direction storage
@@ -29,6 +23,8 @@ private:
     int tex_count;          // Counter to determine which texture to draw
     float dead_tex_count;   // Counter to determine which sprite of death animation sequence to draw
     bool ready;             // Flag prevents incorrect Pac-Man texture or position rounding at start of game
+    int turnWindow;         // Ticks ahead of a junction a turn may be pressed and still be taken there, or 0 for any
+    int turnAge;            // Ticks the proposed direction has waited to be taken
 
 public:
     /**
@@ -36,22 +32,25 @@ public:
      */
     Pacman()
     {
-        x = 13.5f;
-        y = 7.0f;
+        x = 13 * SUB_TILE + SUB_TILE / 2;   // Starts between tiles 13 and 14
+        y = 7 * SUB_TILE;
         angle = 0.0f;
         dir = NONE;
         tempDir = NONE;
         tex_count = 10;
         dead_tex_count = 0;
         ready = false;
+        turnWindow = 0;
+        turnAge = 0;
     }
     void reset()
     {
-        x = 13.5f;
-        y = 7.0f;
+        x = 13 * SUB_TILE + SUB_TILE / 2;   // Starts between tiles 13 and 14
+        y = 7 * SUB_TILE;
         angle = 0.0f;
         dir = NONE;
         tempDir = NONE;
+        turnAge = 0;
         tex_count = 10;
         dead_tex_count = 0;
         ready = false;
@@ -64,7 +63,7 @@ public:
      */
     int getX()
     {
-        return round(x);
+        return toTile(x);
     }
 
     /**
@@ -74,43 +73,26 @@ public:
      */
     int getY()
     {
-        return round(y);
+        return toTile(y);
     }
 
     /**
-     * Determines and returns the next tile in the given direction of movement
-     *
-     * @param d - direction of movement in which to check to the next tile
-     * @return -  next tile in direction d
+     * @return - Pac-Man's exact position, in sub-tile units
      */
-    tile getNextTile(direction d)
+    Point getPosition() const
     {
-        // Return next tile in given direction
-        switch(d)
-        {
-            case UP:
-                return getTile(getX(),getY() + 1);
-            case RIGHT:
-                return getTile(getX() + 1,getY());
-            case DOWN:
-                return getTile(getX(),getY() - 1);
-            case LEFT:
-                return getTile(getX() - 1,getY());
-            default:
-                return getTile(getX(),getY());  // If d=NONE, return current tile
-        }
+        return {x, y};
     }
 
     /**
      * Determines whether Pac-Man is currently at the center of a tile
-     * Expression basically validates that the first decimal point of each coordinate is a zero
-     * If each is a zero, Pac-Man is at the center of his tile
+     * If each coordinate is a whole number of tiles, Pac-Man is at the center of his tile
      *
      * @return - boolean, true if at center
      */
     bool atTileCenter()
     {
-        return (int)round(y * 10.0f) % 10 == 0 && (int)round(x * 10.0f) % 10 == 0;
+        return y % SUB_TILE == 0 && x % SUB_TILE == 0;
     }
 
     /**
@@ -131,6 +113,18 @@ public:
     void setDirection(direction d)
     {
         tempDir = d;
+        turnAge = 0;
+    }
+
+    /**
+     * Set how many ticks ahead of a junction a turn may be pressed and still be taken there - a turn not taken in
+     * time is dropped, and Pac-Man carries straight on. Kept across resets, as an option for the whole game
+     *
+     * @param ticks - ticks a turn is held for, or 0 to hold every turn until it can be taken
+     */
+    void setTurnWindow(int ticks)
+    {
+        turnWindow = ticks;
     }
 
     /**
@@ -146,17 +140,25 @@ public:
      */
     void move()
     {
+        PHASE(PHASE_PACMAN);
+
+        uint8_t exits = getExits(getX(),getY());   // Exits from the current tile
+
+        // Drop a proposed turn held for longer than the turn window
+        if(turnWindow > 0 && tempDir != dir && turnAge++ >= turnWindow)
+            tempDir = dir;
+
         // Ascertain whether direction can be changed
         // Direction can only be changed at the center of a tile
         if(atTileCenter())
         {
-            if(!isImpassible(getNextTile(tempDir))) // If the proposed direction is not impassible, update direction
+            if(canExit(exits,tempDir))      // If the proposed direction is not impassible, update direction
                 dir = tempDir;
-            else if(isImpassible(getNextTile(dir))) // If the current direction is impassible, set dir=NONE
+            else if(!canExit(exits,dir))    // If the current direction is impassible, set dir=NONE
                 dir = NONE;
         }
         // The only exception to the above rule is at game start (when ready=false), as Pac-Man starts between two tiles
-        if(!ready && tempDir != NONE && !isImpassible(getNextTile(tempDir)))
+        if(!ready && tempDir != NONE && canExit(exits,tempDir))
         {
             dir = tempDir;
             if(!ready)
@@ -169,26 +171,26 @@ public:
         switch(dir)
         {
             case UP:
-                y += 0.1f;
-                x = round(x);
+                y += SUB_TILE / 10;
+                x = snapToTile(x);
                 break;
             case RIGHT:
-                x += 0.1f;
-                y = round(y);
+                x += SUB_TILE / 10;
+                y = snapToTile(y);
                 break;
             case DOWN:
-                y -= 0.1f;
-                x = round(x);
+                y -= SUB_TILE / 10;
+                x = snapToTile(x);
                 break;
             case LEFT:
-                x -= 0.1f;
-                y = round(y);
+                x -= SUB_TILE / 10;
+                y = snapToTile(y);
                 break;
             default:                // If not moving, round both coordinates, centering Pac-Man within the tile
                 if(ready)           // Only do if Pac-Man has already moved (ready=true)
                 {                   // This allows starting X position to be non-rounded
-                    x = round(x);
-                    y = round(y);
+                    x = snapToTile(x);
+                    y = snapToTile(y);
                 }
                 break;
         }
@@ -201,32 +203,31 @@ public:
      *      Fruit: increment consumed fruit count, empty array position and determine & return how much the fruit is worth
      * Only eat current tile if at tile center
      *
-     * @return - integer score increment from eating tile
+     * @param board - board from which to eat
+     * @return -      integer score increment from eating tile
      */
-    int eat()
+    int eat(Board& board)
     {
         if(atTileCenter())
         {
-            switch(getTile(getX(),getY()))
+            switch(getTile(board,getX(),getY()))
             {
                 case o:
-                    setTile(getX(),getY(),e);
-                    pillsLeft--;
+                    setTile(board,getX(),getY(),e);
                     return 10;
                 case O:
-                    setTile(getX(),getY(),E);
-                    pillsLeft--;
+                    setTile(board,getX(),getY(),E);
                     return 50;
                 case P:
                     if(dir == RIGHT)
-                        x = 1;
+                        x = 1 * SUB_TILE;
                     else
-                        x = 26;
+                        x = 26 * SUB_TILE;
                     return 0;
                 case F:
-                    setTile(getX(),getY(),e);
-                    fruitSpawned = false;
-                    switch(fruits++)
+                    setTile(board,getX(),getY(),e);
+                    board.fruitSpawned = false;
+                    switch(board.fruits++)
                     {
                         case 0:
                             return 100;
@@ -250,16 +251,17 @@ public:
         return 0;
     }
 
+#ifndef PACMAN_HEADLESS
     /**
      * Draw Pac-Man at his current location
      */
     void draw()
     {
-        glPushMatrix();
+        pushTranslation();
 
         translateMapOrigin();               // Translate to map origin
-        translateMapCoords(x,y);            // Translate to current (x,y)
-        glTranslatef(-2.0f, -2.0f, 0.0f);   // Account for over-sized sprite (13x13 on 8x8 tile)
+        translateSubTileCoords(x,y);        // Translate to current (x,y)
+        translate(-2.0f, -2.0f);   // Account for over-sized sprite (13x13 on 8x8 tile)
 
         // Determine rotation angle of sprite based on direction
         switch(dir)
@@ -290,13 +292,20 @@ public:
         // Draw Pac-Man sprite with determined texture at determined angle
         drawSprite(pacman_tex, 13, 13, angle);
 
+        popTranslation();
+    }
+
+    /**
+     * Advance Pac-Man's eating animation by one tick, once per tick that he is drawn
+     */
+    void animate()
+    {
         // Increment texture counter only if moving
         // If stationary, continue until sprite animation cycle is complete
         if(!(dir == NONE && tex_count % 20 < 5) && ready)
             tex_count++;
-
-        glPopMatrix();
     }
+#endif //PACMAN_HEADLESS
 
     /**
      * Stop Pac-Man's eating animation when he dies/completes level or pause it upon eating a ghost - also save tempDir
@@ -305,6 +314,7 @@ public:
     {
         saveDir = tempDir;
         tempDir = NONE;
+        turnAge = 0;
         ready = false;
     }
 
@@ -314,20 +324,24 @@ public:
     void startChomping()
     {
         if(tempDir == NONE)
+        {
             tempDir = saveDir;
+            turnAge = 0;    // The restored turn waits afresh, rather than for as long as it had before the pause
+        }
         ready = true;
     }
 
+#ifndef PACMAN_HEADLESS
     /**
      * Draw Pac-Man's death animation sequence at his current location
      */
     void drawDead()
     {
-        glPushMatrix();
+        pushTranslation();
 
         translateMapOrigin();               // Translate to map origin
-        translateMapCoords(x,y);            // Translate to current (x,y)
-        glTranslatef(-3.0f, -4.0f, 0.0f);   // Account for over-sized sprite (15x15 on 8x8 tile)
+        translateSubTileCoords(x,y);        // Translate to current (x,y)
+        translate(-3.0f, -4.0f);   // Account for over-sized sprite (15x15 on 8x8 tile)
 
         // Determine which texture to draw based on tick-incremented counter
         int deadFrame = (int)floor(dead_tex_count / 5);
@@ -337,31 +351,36 @@ public:
         if(dead_tex_count < 55)
             drawSprite(pacman_tex, 15, 15, 0);
 
-        // Increment dead texture counter
-        dead_tex_count++;
+        popTranslation();
+    }
 
-        glPopMatrix();
+    /**
+     * Advance Pac-Man's death animation sequence by one tick, once per tick that it is drawn
+     */
+    void animateDead()
+    {
+        dead_tex_count++;
     }
 
     /**
      * Upon eating a fruit, draw the score for eating said fruit during the short pause INSTEAD of drawing Pac-Man
+     *
+     * @param fruits - number of fruits consumed so far, including the one just eaten
      */
-    void drawFruitScore()
+    void drawFruitScore(int fruits)
     {
-        glPushMatrix();
+        pushTranslation();
 
         translateMapOrigin();               // Translate to map origin
-        translateMapCoords(x,y);            // Translate to current (x,y)
-        glTranslatef(-6.0f, 0.0f, 0.0f);   // Account for over-sized sprite (20x8 on 8x8 tile)
+        translateSubTileCoords(x,y);        // Translate to current (x,y)
+        translate(-6.0f, 0.0f);   // Account for over-sized sprite (20x8 on 8x8 tile)
 
         // Determine which fruit score texture to draw based on how many fruits have been eaten
         drawSprite(f_score_tex[fruits - 1], 20, 8, 0);
 
-        glPopMatrix();
+        popTranslation();
     }
+#endif //PACMAN_HEADLESS
 };
 
-// Initialise Pac-Man object
-Pacman pacman;
-
 #endif //PACMAN_PACMAN_H
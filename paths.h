@@ -0,0 +1,158 @@
+/**
+ * Header file responsible for travel distances through the maze
+ *
+ * The maze has only a few hundred passable tiles, so the shortest path distance between every pair of them is found
+ * once at startup by a breadth first search from each tile, and stored in a compact table of bytes. Paths respect
+ * walls and gates, and wrap through the portals, exactly as Pac-Man & Ghosts move (see the exit table in map.h).
+ * Any distance, or the first step along a shortest path, can then be looked up in constant time.
+ */
+
+#ifndef PACMAN_PATHS_H
+#define PACMAN_PATHS_H
+
+// Distance returned between tiles with no path between them, or tiles outside the maze
+const int NO_PATH = -1;
+
+/**
+ * Get the tile neighbouring a given tile in a given direction, wrapping around through the portals
+ *
+ * @param p - tile from which to step
+ * @param d - direction of the step
+ * @return -  neighbouring tile in direction d, or p itself if d=NONE
+ */
+Point stepFrom(Point p, direction d)
+{
+    switch(d)
+    {
+        case UP:
+            return {p.x, p.y + 1};
+        case RIGHT:
+            return {(p.x + 1) % 28, p.y};
+        case DOWN:
+            return {p.x, p.y - 1};
+        case LEFT:
+            return {(p.x + 27) % 28, p.y};
+        default:
+            return p;
+    }
+}
+
+/**
+ * Table of shortest path distances between every pair of passable tiles
+ * Passable tiles are numbered in map order, and distances stored in a square array indexed by these numbers
+ * Unreachable pairs (such as the inside of the SPAWN pen, sealed by its gate) are stored as 0xFF
+ */
+struct PathTable
+{
+    int16_t index[28][31];      // Number of each tile among the passable tiles, -1 if impassible
+    int count;                  // Number of passable tiles
+    vector<uint8_t> distances;  // count*count distances, row by row
+
+    PathTable()
+    {
+        count = 0;
+        for(int x=0;x<28;x++)
+            for(int y=0;y<31;y++)
+                index[x][y] = isImpassible(mapLayout[x][y]) ? -1 : count++;
+
+        distances.assign((size_t)count * count, 0xFF);
+        vector<Point> queue(count);
+        for(int x=0;x<28;x++)
+        {
+            for(int y=0;y<31;y++)
+            {
+                if(index[x][y] != -1)
+                    search({x, y}, queue);
+            }
+        }
+    }
+
+    /**
+     * Breadth first search outwards from a tile, filling in its row of the distance table
+     *
+     * @param source - tile from which to search
+     * @param queue -  storage for the search's queue, with room for every passable tile
+     */
+    void search(Point source, vector<Point>& queue)
+    {
+        uint8_t* row = &distances[(size_t)index[source.x][source.y] * count];
+        int head = 0;
+        int tail = 0;
+        row[index[source.x][source.y]] = 0;
+        queue[tail++] = source;
+        while(head < tail)
+        {
+            Point p = queue[head++];
+            uint8_t exits = getExits(p.x, p.y);
+            for(int d = UP; d <= LEFT; d++)
+            {
+                if(!(exits & exitBit(static_cast<direction>(d))))
+                    continue;
+                Point next = stepFrom(p, static_cast<direction>(d));
+                uint8_t& distance = row[index[next.x][next.y]];
+                if(distance == 0xFF)
+                {
+                    distance = row[index[p.x][p.y]] + 1;
+                    queue[tail++] = next;
+                }
+            }
+        }
+    }
+};
+
+const PathTable pathTable;
+
+/**
+ * Get the number of the given tile among the passable tiles
+ *
+ * @param p - tile to look up
+ * @return -  number of the tile, or -1 if it is impassible or outside the map
+ */
+int pathIndex(Point p)
+{
+    if(p.x < 0 || p.x >= 28 || p.y < 0 || p.y >= 31)
+        return -1;
+    return pathTable.index[p.x][p.y];
+}
+
+/**
+ * Get the length of the shortest path through the maze between two tiles
+ *
+ * @param a - tile from which to travel
+ * @param b - tile to which to travel
+ * @return -  number of tiles travelled along the shortest path, or NO_PATH if there is none
+ */
+int mazeDistance(Point a, Point b)
+{
+    int i = pathIndex(a);
+    int j = pathIndex(b);
+    if(i == -1 || j == -1)
+        return NO_PATH;
+    uint8_t distance = pathTable.distances[(size_t)i * pathTable.count + j];
+    return distance == 0xFF ? NO_PATH : distance;
+}
+
+/**
+ * Get the direction of the first step along a shortest path through the maze between two tiles
+ * Where several shortest paths exist, directions are preferred in the order UP, RIGHT, DOWN, LEFT
+ *
+ * @param from - tile from which to travel
+ * @param to -   tile to which to travel
+ * @return -     direction of the first step, or NONE if already there or there is no path
+ */
+direction nextStep(Point from, Point to)
+{
+    int distance = mazeDistance(from, to);
+    if(distance == NO_PATH || distance == 0)
+        return NONE;
+
+    uint8_t exits = getExits(from.x, from.y);
+    for(int d = UP; d <= LEFT; d++)
+    {
+        if((exits & exitBit(static_cast<direction>(d))) && mazeDistance(stepFrom(from, static_cast<direction>(d)), to) == distance - 1)
+            return static_cast<direction>(d);
+    }
+    return NONE;
+}
+
+#endif //PACMAN_PATHS_H
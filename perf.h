@@ -0,0 +1,196 @@
+/**
+ * Header file responsible for counting hardware performance events (cycles, instructions, cache misses and branch
+ * misses) through Linux perf_event_open, separately for each phase of a tick, for the headless simulation to report.
+ *
+ * Each phase is counted by the PHASE() marking it (see profile.h), which reads the thread's counters as the phase
+ * begins and ends - events within a nested phase are counted to it alone. Only events in user space are counted, so the reads themselves add little to the counts, though
+ * they do slow the run. Every thread opens its own counters on its first phase counted - none are opened or read while
+ * the thread is not instrumented (see profile.h). Where the kernel refuses a counter (e.g. in a virtual machine, or with
+ * perf_event_paranoid set too high) it is reported as unavailable.
+ *
+ * Everything here compiles to nothing unless PACMAN_PERF is defined, set through the PERF make flag (Linux only).
+ */
+
+#ifndef PACMAN_PERF_H
+#define PACMAN_PERF_H
+
+#ifdef PACMAN_PERF
+// Hardware events counted, and their names as reported
+enum perfCounter {PERF_CYCLES, PERF_INSTRUCTIONS, PERF_CACHE_MISSES, PERF_BRANCH_MISSES, PERF_COUNTERS};
+const char* const PERF_NAMES[PERF_COUNTERS] = {"cycles", "instructions", "cache-misses", "branch-misses"};
+const uint64_t PERF_CONFIGS[PERF_COUNTERS] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+                                              PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+const int PERF_PHASES = PHASE_MAP;  // Only the phases of a tick, which all come before the phases of a frame, are counted
+
+// Values of every counter open on a thread, as read together as a group
+struct PerfReading
+{
+    uint64_t count;                     // Number of counters read
+    uint64_t values[PERF_COUNTERS];     // Value of each counter, in the order opened
+};
+
+// Counters of a single thread, and the events they have counted in each phase
+struct PerfThread
+{
+    int group;                                      // File descriptor of the group's leading counter, or -1
+    int slots[PERF_COUNTERS];                       // Position of each counter within a reading, or -1 if refused
+    uint64_t totals[PERF_PHASES][PERF_COUNTERS];    // Events counted in each phase
+};
+
+vector<PerfThread*> perfThreads;                // Counters of every thread that has counted a phase
+mutex perfLock;                                 // Guards perfThreads as threads start counting
+thread_local PerfThread* perfThread = NULL;     // Counters of the current thread, once it has counted a phase
+
+/**
+ * Open a hardware event counter on the current thread, counting only in user space
+ *
+ * @param config - hardware event to count
+ * @param group -  file descriptor of the group's leading counter, or -1 to lead a new group
+ * @return -       file descriptor of the counter, or -1 if refused
+ */
+int openPerfCounter(uint64_t config, int group)
+{
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = config;
+    attr.read_format = PERF_FORMAT_GROUP;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return syscall(__NR_perf_event_open, &attr, 0, -1, group, 0);
+}
+
+/**
+ * Get the current thread's counters, opening them on the thread's first phase
+ *
+ * @return - counters of the current thread
+ */
+PerfThread* perfCounters()
+{
+    if(perfThread == NULL)
+    {
+        PerfThread* counters = new PerfThread();
+        counters->group = -1;
+        int opened = 0;
+        for(int c = 0; c < PERF_COUNTERS; c++)
+        {
+            int fd = openPerfCounter(PERF_CONFIGS[c], counters->group);
+            counters->slots[c] = fd == -1 ? -1 : opened++;
+            if(counters->group == -1)
+                counters->group = fd;
+        }
+
+        lock_guard<mutex> guard(perfLock);
+        perfThreads.push_back(counters);
+        perfThread = counters;
+    }
+    return perfThread;
+}
+
+/**
+ * Read every counter open on the current thread
+ *
+ * @param counters - counters of the current thread
+ * @param reading -  set to the value of each counter
+ * @return -         true if the counters were read
+ */
+inline bool readPerfCounters(const PerfThread* counters, PerfReading& reading)
+{
+    return counters->group != -1 && read(counters->group, &reading, sizeof(reading)) > 0;
+}
+
+class PerfTimer;
+thread_local PerfTimer* perfTimer = NULL;       // Innermost phase being counted on the current thread, if any
+
+// Counts the events of the scope it is declared in, adding them to a phase of a tick, less those of any nested phases
+class PerfTimer
+{
+private:
+    phase counted;
+    PerfThread* counters;
+    PerfTimer* outer;                   // Phase this one is nested within, or NULL
+    uint64_t nested[PERF_COUNTERS];     // Events counted by the phases nested within this one, by slot
+    PerfReading start;
+    bool started;
+
+public:
+    PerfTimer(phase p) : counted(p), counters(instrumented ? perfCounters() : NULL), outer(perfTimer), nested()
+    {
+        started = counters != NULL && p < PERF_PHASES && readPerfCounters(counters, start);
+        if(started)
+            perfTimer = this;
+    }
+    ~PerfTimer()
+    {
+        if(!started)
+            return;
+        perfTimer = outer;
+        PerfReading end;
+        if(!readPerfCounters(counters, end))
+            return;
+        for(int c = 0; c < PERF_COUNTERS; c++)
+        {
+            int slot = counters->slots[c];
+            if(slot == -1)
+                continue;
+            uint64_t events = end.values[slot] - start.values[slot];
+            counters->totals[counted][c] += events - nested[c];
+            if(outer != NULL)
+                outer->nested[c] += events;
+        }
+    }
+};
+
+#define PERF_JOIN(a, b) a##b
+#define PERF_NAME(line) PERF_JOIN(perfTimer, line)
+#define PERF_PHASE(p) PerfTimer PERF_NAME(__LINE__)(p)
+
+/**
+ * Print the events counted in each phase of a tick across every thread, per million ticks
+ * Must only be called while no other thread is counting - once worker threads have been joined
+ *
+ * @param ticks - ticks stepped across every game
+ */
+void printPerfCounters(long long ticks)
+{
+    lock_guard<mutex> guard(perfLock);
+    uint64_t totals[PERF_PHASES][PERF_COUNTERS] = {};
+    bool available[PERF_COUNTERS] = {};
+    for(size_t t = 0; t < perfThreads.size(); t++)
+    {
+        for(int c = 0; c < PERF_COUNTERS; c++)
+        {
+            available[c] = available[c] || perfThreads[t]->slots[c] != -1;
+            for(int p = 0; p < PERF_PHASES; p++)
+                totals[p][c] += perfThreads[t]->totals[p][c];
+        }
+    }
+
+    printf("\nper million ticks (user space only):\n");
+    printf("%-12s", "phase");
+    for(int c = 0; c < PERF_COUNTERS; c++)
+        printf(" %15s", PERF_NAMES[c]);
+    printf(" %6s\n", "IPC");
+    for(int p = PHASE_COLLISIONS; p < PERF_PHASES; p++)
+    {
+        printf("%-12s", PHASE_NAMES[p]);
+        for(int c = 0; c < PERF_COUNTERS; c++)
+        {
+            if(available[c])
+                printf(" %15.0f", (double)totals[p][c] * 1e6 / max(ticks, 1LL));
+            else
+                printf(" %15s", "unavailable");
+        }
+        if(available[PERF_CYCLES] && available[PERF_INSTRUCTIONS] && totals[p][PERF_CYCLES] > 0)
+            printf(" %6.2f\n", (double)totals[p][PERF_INSTRUCTIONS] / totals[p][PERF_CYCLES]);
+        else
+            printf(" %6s\n", "-");
+    }
+}
+#else
+#define PERF_PHASE(p) ((void)0)
+inline void printPerfCounters(long long) {}
+#endif //PACMAN_PERF
+
+#endif //PACMAN_PERF_H
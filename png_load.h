@@ -136,4 +136,106 @@ int png_load(const char* file_name,
 	return 1;
 }
 
+// open a PNG file and create the libpng structs to read it, having checked its signature
+static int png_open(const char* file_name, FILE** fp_ptr, png_structp* png_ptr, png_infop* info_ptr)
+{
+    png_byte header[8];
+
+    FILE* fp = fopen(file_name, "rb");
+    if (fp == 0)
+    {
+        fprintf(stderr, "erro: could not open PNG file %s\n", file_name);
+        perror(file_name);
+        return 0;
+    }
+
+    if (fread(header, 1, 8, fp) != 8 || png_sig_cmp(header, 0, 8))
+    {
+        fprintf(stderr, "error: %s is not a PNG.\n", file_name);
+        fclose(fp);
+        return 0;
+    }
+
+    *png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+    *info_ptr = *png_ptr ? png_create_info_struct(*png_ptr) : NULL;
+    if (!*info_ptr)
+    {
+        fprintf(stderr, "error: could not create png read structs.\n");
+        png_destroy_read_struct(png_ptr, (png_infopp)NULL, (png_infopp)NULL);
+        fclose(fp);
+        return 0;
+    }
+
+    png_init_io(*png_ptr, fp);
+    png_set_sig_bytes(*png_ptr, 8);
+    *fp_ptr = fp;
+    return 1;
+}
+
+// read only the width and height of a PNG image, without decoding it
+int png_size(const char* file_name, int* width, int* height)
+{
+    FILE* fp;
+    png_structp png_ptr;
+    png_infop info_ptr;
+    if (!png_open(file_name, &fp, &png_ptr, &info_ptr))
+        return 0;
+
+    if (setjmp(png_jmpbuf(png_ptr))) {
+        fprintf(stderr, "error from libpng\n");
+        png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
+        fclose(fp);
+        return 0;
+    }
+
+    png_read_info(png_ptr, info_ptr);
+    *width = png_get_image_width(png_ptr, info_ptr);
+    *height = png_get_image_height(png_ptr, info_ptr);
+
+    png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
+    fclose(fp);
+    return 1;
+}
+
+// decode an 8-bit RGBA PNG image of known size straight into memory provided by the caller, such as a mapped
+// pixel buffer - rows are stored bottom up from bottom_row, stride bytes apart, so no image buffer is allocated
+int png_load_into(const char* file_name, int width, int height, char* bottom_row, int stride)
+{
+    FILE* fp;
+    png_structp png_ptr;
+    png_infop info_ptr;
+    if (!png_open(file_name, &fp, &png_ptr, &info_ptr))
+        return 0;
+
+    if (setjmp(png_jmpbuf(png_ptr))) {
+        fprintf(stderr, "error from libpng\n");
+        png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
+        fclose(fp);
+        return 0;
+    }
+
+    png_read_info(png_ptr, info_ptr);
+    int passes = png_set_interlace_handling(png_ptr);
+    png_read_update_info(png_ptr, info_ptr);
+    if ((int)png_get_image_width(png_ptr, info_ptr) != width || (int)png_get_image_height(png_ptr, info_ptr) != height ||
+        png_get_rowbytes(png_ptr, info_ptr) != (png_size_t)width * 4)
+    {
+        fprintf(stderr, "error: %s is not a %dx%d RGBA PNG.\n", file_name, width, height);
+        png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
+        fclose(fp);
+        return 0;
+    }
+
+    // read row by row, flipping the image as png_load does
+    for (int pass = 0; pass < passes; pass++)
+    {
+        for (int i = 0; i < height; i++)
+            png_read_row(png_ptr, (png_bytep)(bottom_row + (height - 1 - i) * stride), NULL);
+    }
+
+    png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
+    fclose(fp);
+    return 1;
+}
+
 #endif //PNGLOAD_H
@@ -0,0 +1,169 @@
+/**
+ * Header file responsible for profiling the game, timing each phase of the ticks and frames and counting the work done
+ * to draw them, for display on the profiling HUD (see ui.h).
+ *
+ * Phases are timed by placing PHASE(name) at the start of the scope to be timed, and work counted by PROFILE_COUNT().
+ * Phases may nest - the time of a nested phase is added to it alone, not to the phase around it.
+ * Both compile to nothing unless PACMAN_PROFILE is defined, as the windowed game is built by default - the headless
+ * simulation never defines it. The time and work of every tick run before a frame is added to that frame.
+ * Each phase is also recorded as a span by the tracer (see trace.h), and its hardware events counted (see perf.h), if
+ * either is compiled in. Phases run while the thread is not instrumented are neither timed, traced nor counted.
+ */
+
+#ifndef PACMAN_PROFILE_H
+#define PACMAN_PROFILE_H
+
+// Phases of a tick (input to wave) and of a frame (map to swap) timed by the profiler
+enum phase {PHASE_INPUT, PHASE_COLLISIONS, PHASE_PACMAN, PHASE_GHOSTS, PHASE_WAVE,
+            PHASE_MAP, PHASE_CHARACTERS, PHASE_UI, PHASE_SWAP, PHASE_COUNT};
+const char* const PHASE_NAMES[PHASE_COUNT] = {"input", "collisions", "pacman", "ghosts", "wave",
+                                              "map", "characters", "ui", "swap"};
+
+// Work counted while drawing a frame
+enum counter {COUNTER_SPRITES, COUNTER_BINDS, COUNTER_DRAWS, COUNTER_COUNT};
+
+// False while the current thread steps copies of the game rather than the game itself (see mcts.h) - the profiler, the
+// tracer and the performance counters then record nothing, leaving their results to the game's own work
+thread_local bool instrumented = true;
+
+#ifdef PACMAN_PROFILE
+const int PROFILE_FRAMES = 256;         // Frames over which the rolling percentiles are taken
+const float TICK_BUDGET_MS = 1000.0f / 30;  // Longest a tick may take, at 30 ticks per second, without falling behind
+
+struct Profile
+{
+    bool visible;                                       // True if the HUD is shown
+    long long phaseTime[PHASE_COUNT];                   // Nanoseconds spent in each phase during the current frame
+    long long counters[COUNTER_COUNT];                  // Work counted during the current frame
+    long long slowestTick;                              // Nanoseconds taken by the slowest tick of the current frame
+    long long lastCounters[COUNTER_COUNT];              // Work counted during the last frame drawn
+    float phaseHistory[PHASE_COUNT][PROFILE_FRAMES];    // Milliseconds spent in each phase by each recent frame
+    float frameHistory[PROFILE_FRAMES];                 // Milliseconds between each recent frame and the one before
+    float tickHistory[PROFILE_FRAMES];                  // Milliseconds taken by the slowest tick of each recent frame
+    int frames;                                         // Frames recorded, wrapping around the history
+    steady_clock::time_point lastFrame;                 // Time at which the last frame was recorded
+};
+Profile profile = {};
+
+class PhaseTimer;
+thread_local PhaseTimer* phaseTimer = NULL;     // Innermost phase being timed on the current thread, if any
+
+// Times the scope it is declared in, adding the time to a phase of the current frame, less that of any nested phases
+class PhaseTimer
+{
+private:
+    phase timed;
+    bool timing;        // False if the thread was not instrumented as the phase began
+    PhaseTimer* outer;  // Phase this one is nested within, or NULL
+    long long nested;   // Nanoseconds spent in the phases nested within this one
+    steady_clock::time_point start;
+
+public:
+    PhaseTimer(phase p) : timed(p), timing(instrumented), outer(phaseTimer), nested(0)
+    {
+        if(!timing)
+            return;
+        phaseTimer = this;
+        start = steady_clock::now();
+    }
+    ~PhaseTimer()
+    {
+        if(!timing)
+            return;
+        long long time = duration_cast<nanoseconds>(steady_clock::now() - start).count();
+        profile.phaseTime[timed] += time - nested;
+        if(outer != NULL)
+            outer->nested += time;
+        phaseTimer = outer;
+    }
+};
+
+#define PHASE_JOIN(a, b) a##b
+#define PHASE_NAME(line) PHASE_JOIN(phaseTimer, line)
+#define PROFILE_PHASE(p) PhaseTimer PHASE_NAME(__LINE__)(p)
+#define PROFILE_COUNT(c) (profile.counters[c]++)
+
+/**
+ * Record the time taken by a tick of the current frame
+ *
+ * @param time - time taken by the tick
+ */
+void endProfileTick(steady_clock::duration time)
+{
+    profile.slowestTick = max(profile.slowestTick, (long long)duration_cast<nanoseconds>(time).count());
+}
+
+/**
+ * Record the current frame in the history once it has been drawn, then start timing the next
+ */
+void endProfileFrame()
+{
+    steady_clock::time_point now = steady_clock::now();
+    int slot = profile.frames % PROFILE_FRAMES;
+    for(int p = 0; p < PHASE_COUNT; p++)
+        profile.phaseHistory[p][slot] = profile.phaseTime[p] / 1e6f;
+    profile.frameHistory[slot] = profile.frames == 0 ? 0 : duration<float, milli>(now - profile.lastFrame).count();
+    profile.tickHistory[slot] = profile.slowestTick / 1e6f;
+    profile.frames++;
+    profile.lastFrame = now;
+
+    memcpy(profile.lastCounters, profile.counters, sizeof(profile.counters));
+    memset(profile.counters, 0, sizeof(profile.counters));
+    memset(profile.phaseTime, 0, sizeof(profile.phaseTime));
+    profile.slowestTick = 0;
+}
+
+/**
+ * Get the number of frames currently held in the history
+ *
+ * @return - frames held, up to PROFILE_FRAMES
+ */
+int profileFrames()
+{
+    return min(profile.frames, PROFILE_FRAMES);
+}
+
+/**
+ * Find a percentile of the recent values of a measurement
+ *
+ * @param history -    recent values of the measurement, up to PROFILE_FRAMES
+ * @param count -      number of values held in the history
+ * @param percentile - percentile to find, from 0 to 100
+ * @return -           value at the percentile, or 0 if no values are held
+ */
+float profilePercentile(const float* history, int count, float percentile)
+{
+    count = min(count, PROFILE_FRAMES);
+    if(count == 0)
+        return 0;
+    float values[PROFILE_FRAMES];
+    memcpy(values, history, count * sizeof(float));
+    int rank = min((int)(percentile / 100 * count), count - 1);
+    nth_element(values, values + rank, values + count);
+    return values[rank];
+}
+
+/**
+ * Count the recent frames in which a tick took longer than its budget
+ *
+ * @return - number of frames over budget held in the history
+ */
+int ticksOverBudget()
+{
+    int over = 0;
+    for(int i = 0; i < profileFrames(); i++)
+    {
+        if(profile.tickHistory[i] > TICK_BUDGET_MS)
+            over++;
+    }
+    return over;
+}
+#else
+#define PROFILE_PHASE(p) ((void)0)
+#define PROFILE_COUNT(c) ((void)0)
+#endif //PACMAN_PROFILE
+
+// Time a phase for the profiler, record it as a span for the tracer and count its hardware events
+#define PHASE(p) PROFILE_PHASE(p); TRACE_SPAN(PHASE_NAMES[p]); PERF_PHASE(p)
+
+#endif //PACMAN_PROFILE_H
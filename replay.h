@@ -0,0 +1,227 @@
+/**
+ * Header file responsible for recording games as replays, and playing them back
+ *
+ * The game is deterministic given its seed, options and inputs, so a replay need only hold those. Every input that
+ * changes the state of the game - a direction applied to Pac-Man, pausing, resuming or restarting - is recorded as an
+ * action, along with the tick before which it was applied, counting every tick stepped since the session began.
+ * Playback applies each action through the same functions as live input, before the same tick.
+ *
+ * A replay file is laid out as:
+ *      Header:  magic, version, seed, options, and the ticks recorded along with the final score and level
+ *      Actions: one variable length integer per action - the ticks since the previous action shifted left by three
+ *               bits, then the action in the lowest three bits - seven bits per byte, lowest first, with the top bit
+ *               set on every byte but the last
+ * All values in the header are stored in the byte order of the machine that recorded the replay.
+ */
+
+#ifndef PACMAN_REPLAY_H
+#define PACMAN_REPLAY_H
+
+const char REPLAY_MAGIC[4] = {'P', 'M', 'R', 'P'};
+const uint32_t REPLAY_VERSION = 1;
+const uint32_t REPLAY_PATH_GHOSTS = 1;  // Flag set when the ghosts targeted by path distance
+
+// Inputs that change the state of a game - directions keep the values of their direction enum
+enum action {ACTION_UP = UP, ACTION_RIGHT = RIGHT, ACTION_DOWN = DOWN, ACTION_LEFT = LEFT,
+             ACTION_PAUSE, ACTION_RESUME, ACTION_RESTART};
+
+struct ReplayHeader
+{
+    char magic[4];          // REPLAY_MAGIC
+    uint32_t version;       // REPLAY_VERSION
+    uint64_t seed;          // Seed of the game's random number generator
+    uint32_t flags;         // REPLAY_PATH_GHOSTS, or 0
+    int32_t turnWindow;     // Turn window of Pac-Man, in ticks
+    int64_t ticks;          // Ticks stepped over the whole session
+    int32_t score;          // Score when recording ended, against which playback is checked
+    int32_t level;          // Level when recording ended
+    uint32_t actionCount;   // Number of actions following the header
+};
+
+// An action, and the tick before which it was applied
+struct ReplayAction
+{
+    long long tick;
+    action act;
+};
+
+struct Replay
+{
+    ReplayHeader header;
+    vector<ReplayAction> actions;   // Every action, in the order applied
+};
+
+/**
+ * Start a replay of a new session
+ *
+ * @param replay -     replay to start
+ * @param seed -       seed of the game's random number generator
+ * @param pathGhosts - true if the ghosts target by path distance
+ * @param turnWindow - turn window of Pac-Man, in ticks
+ */
+void startReplay(Replay& replay, uint64_t seed, bool pathGhosts, int turnWindow)
+{
+    memset(&replay.header, 0, sizeof(replay.header));
+    memcpy(replay.header.magic, REPLAY_MAGIC, 4);
+    replay.header.version = REPLAY_VERSION;
+    replay.header.seed = seed;
+    replay.header.flags = pathGhosts ? REPLAY_PATH_GHOSTS : 0;
+    replay.header.turnWindow = turnWindow;
+    replay.actions.clear();
+}
+
+/**
+ * Set up a game to play back a replay from the start
+ *
+ * @param game -   game to set up
+ * @param replay - replay to play back
+ */
+void setupReplay(GameState& game, const Replay& replay)
+{
+    game = GameState(replay.header.seed);
+    setPathGhosts(game, (replay.header.flags & REPLAY_PATH_GHOSTS) != 0);
+    setTurnWindow(game, replay.header.turnWindow);
+}
+
+/**
+ * Apply an action to a game, exactly as the live input making it does
+ *
+ * @param game - game to which to apply the action
+ * @param act -  action to apply
+ */
+void applyAction(GameState& game, action act)
+{
+    switch(act)
+    {
+        case ACTION_PAUSE:
+            pauseGame(game);
+            break;
+        case ACTION_RESUME:
+            resumeGame(game);
+            break;
+        case ACTION_RESTART:
+            restartGame(game);
+            break;
+        default:
+            game.pacman.setDirection(static_cast<direction>(act));
+            break;
+    }
+}
+
+/**
+ * Record an action as it is applied
+ *
+ * @param replay - replay being recorded
+ * @param tick -   ticks stepped since the session began
+ * @param act -    action applied
+ */
+void recordAction(Replay& replay, long long tick, action act)
+{
+    ReplayAction recorded = {tick, act};
+    replay.actions.push_back(recorded);
+}
+
+/**
+ * Finish recording a replay, storing the outcome against which playback is checked
+ *
+ * @param replay - replay being recorded
+ * @param game -   game recorded
+ * @param ticks -  ticks stepped over the whole session
+ */
+void finishReplay(Replay& replay, const GameState& game, long long ticks)
+{
+    replay.header.ticks = ticks;
+    replay.header.score = game.score;
+    replay.header.level = game.level;
+    replay.header.actionCount = replay.actions.size();
+}
+
+/**
+ * Write a finished replay to a file
+ *
+ * @param filename - file to write
+ * @param replay -   replay to write
+ * @return -         true if the whole replay was written
+ */
+bool writeReplay(const char* filename, const Replay& replay)
+{
+    vector<unsigned char> bytes;
+    long long previous = 0;
+    for(size_t i = 0; i < replay.actions.size(); i++)
+    {
+        uint64_t value = (uint64_t)(replay.actions[i].tick - previous) << 3 | replay.actions[i].act;
+        previous = replay.actions[i].tick;
+        do
+        {
+            bytes.push_back((value & 0x7F) | (value > 0x7F ? 0x80 : 0));
+            value >>= 7;
+        } while(value > 0);
+    }
+
+    FILE* file = fopen(filename, "wb");
+    if(file == NULL)
+        return false;
+    bool written = fwrite(&replay.header, sizeof(replay.header), 1, file) == 1 &&
+                   fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+    return fclose(file) == 0 && written;
+}
+
+/**
+ * Read a replay from a file
+ *
+ * @param filename - file to read
+ * @param replay -   set to the replay read
+ * @return -         false if the file is missing, or is not a complete replay of this version
+ */
+bool readReplay(const char* filename, Replay& replay)
+{
+    FILE* file = fopen(filename, "rb");
+    if(file == NULL)
+        return false;
+    bool read = fread(&replay.header, sizeof(replay.header), 1, file) == 1 &&
+                memcmp(replay.header.magic, REPLAY_MAGIC, 4) == 0 && replay.header.version == REPLAY_VERSION;
+
+    replay.actions.clear();
+    long long tick = 0;
+    for(uint32_t i = 0; read && i < replay.header.actionCount; i++)
+    {
+        uint64_t value = 0;
+        int c;
+        for(int shift = 0; shift < 64; shift += 7)
+        {
+            if((c = fgetc(file)) == EOF)
+                break;
+            value |= (uint64_t)(c & 0x7F) << shift;
+            if((c & 0x80) == 0)
+                break;
+        }
+        read = c != EOF && (value & 7) >= ACTION_UP && (value & 7) <= ACTION_RESTART;
+        tick += value >> 3;
+        ReplayAction recorded = {tick, static_cast<action>(value & 7)};
+        replay.actions.push_back(recorded);
+    }
+    fclose(file);
+    return read;
+}
+
+/**
+ * Play a replay back from the start as fast as possible, with no window
+ *
+ * @param replay - replay to play back
+ * @param game -   set to the game as it stands once the replay ends
+ */
+void playReplay(const Replay& replay, GameState& game)
+{
+    setupReplay(game, replay);
+    size_t next = 0;
+    for(long long tick = 0; tick < replay.header.ticks; tick++)
+    {
+        while(next < replay.actions.size() && replay.actions[next].tick <= tick)
+            applyAction(game, replay.actions[next++].act);
+        stepGame(game);
+    }
+    while(next < replay.actions.size())     // Actions made after the last tick, before recording ended
+        applyAction(game, replay.actions[next++].act);
+}
+
+#endif //PACMAN_REPLAY_H
@@ -0,0 +1,250 @@
+/**
+ * Header file responsible for the rewind history - a rolling record of the last few minutes of a game, through which the
+ * window can scrub backwards and forwards
+ *
+ * Every state of the game is recorded as it changes, at a fixed memory cost. The history is a ring of segments, each
+ * holding a keyframe - a full snapshot of the game (see savestate.h) - followed by a delta per state after it, up to
+ * REWIND_INTERVAL states per segment. Once every segment is in use the oldest is dropped, so memory never grows.
+ * A state is found by restoring the keyframe of its segment and applying the deltas up to it, so seeking to any state
+ * replays at most one keyframe interval of deltas, and never steps the game itself.
+ *
+ * A delta holds only the 32-bit words of the state that changed since the state before - the tiles eaten and the fields
+ * of the characters and counters that moved on - as runs of:
+ *      Word offset, run length:    one byte each
+ *      Words:                      the old value of each word XOR its new value, in the byte order of the machine
+ * XOR leaves a delta equally able to step a state backwards as forwards. States that did not change at all, such as
+ * those of a paused game, are not recorded.
+ */
+
+#ifndef PACMAN_REWIND_H
+#define PACMAN_REWIND_H
+
+const int REWIND_WORDS = sizeof(GameState) / 4;     // 32-bit words in a state, the unit a delta is taken in
+static_assert(sizeof(GameState) % 4 == 0 && REWIND_WORDS <= 255, "a delta must address every word of a state in a byte");
+
+const int REWIND_INTERVAL = 64;             // States held by each segment - one keyframe, then a delta per state
+const int REWIND_SEGMENTS = 150;            // Segments held, enough for five minutes of play at 30 ticks per second
+const int REWIND_SEGMENT_BYTES = 4096;      // Bytes of deltas each segment can hold before a new keyframe is taken early
+const int REWIND_DELTA_BYTES = sizeof(GameState) + 2 * (REWIND_WORDS / 2 + 1);  // Largest delta, alternating runs
+
+// A keyframe, and the deltas leading on from it
+struct RewindSegment
+{
+    long long position;                         // Position of the keyframe in the history
+    int count;                                  // States held, counting the keyframe
+    int used;                                   // Bytes of deltas held
+    Snapshot keyframe;                          // State at the start of the segment
+    uint16_t ends[REWIND_INTERVAL];             // End offset of each delta, the first leading on from the keyframe
+    unsigned char deltas[REWIND_SEGMENT_BYTES];
+};
+
+// Too large to be held on the stack - must be held in static or heap storage
+struct Rewind
+{
+    RewindSegment segments[REWIND_SEGMENTS];    // Ring of segments, from the oldest
+    int first;                                  // Index of the oldest segment
+    int segmentCount;                           // Segments in use
+    long long start;                            // Position of the oldest state held - positions count every state recorded
+    long long end;                              // Position after the newest state held
+    Snapshot latest;                            // Newest state held, against which the next delta is taken
+};
+
+/**
+ * Take the delta leading from one state to another
+ *
+ * @param from -  state to lead from
+ * @param to -    state to lead to
+ * @param delta - set to the delta, which must have room for REWIND_DELTA_BYTES
+ * @return -      bytes of delta taken, 0 if the states are identical
+ */
+int takeDelta(const Snapshot& from, const GameState& to, unsigned char* delta)
+{
+    const unsigned char* next = reinterpret_cast<const unsigned char*>(&to);
+    int length = 0;
+    int run = -1;   // Position within the delta of the run being extended, if the previous word changed
+    for(int w = 0; w < REWIND_WORDS; w++)
+    {
+        uint32_t a, b;
+        memcpy(&a, from.bytes + w * 4, 4);
+        memcpy(&b, next + w * 4, 4);
+        if(a == b)
+        {
+            run = -1;
+            continue;
+        }
+        if(run == -1)
+        {
+            run = length;
+            delta[length++] = w;
+            delta[length++] = 0;
+        }
+        delta[run + 1]++;
+        uint32_t changed = a ^ b;
+        memcpy(delta + length, &changed, 4);
+        length += 4;
+    }
+    return length;
+}
+
+/**
+ * Apply a delta to a state, stepping it forwards - or, applied to the state it leads to, backwards
+ *
+ * @param state -  state to apply the delta to
+ * @param delta -  delta to apply
+ * @param length - bytes of delta
+ */
+void applyDelta(Snapshot& state, const unsigned char* delta, int length)
+{
+    for(int i = 0; i < length;)
+    {
+        int word = delta[i++];
+        int words = delta[i++];
+        for(int w = word; w < word + words; w++, i += 4)
+        {
+            uint32_t value, changed;
+            memcpy(&value, state.bytes + w * 4, 4);
+            memcpy(&changed, delta + i, 4);
+            value ^= changed;
+            memcpy(state.bytes + w * 4, &value, 4);
+        }
+    }
+}
+
+/**
+ * Start a new segment, keyed on a state, dropping the oldest segment if every segment is in use
+ *
+ * @param rewind - history to add the segment to
+ * @param game -   state to key the segment on
+ */
+void startSegment(Rewind& rewind, const GameState& game)
+{
+    if(rewind.segmentCount == REWIND_SEGMENTS)
+    {
+        rewind.start += rewind.segments[rewind.first].count;
+        rewind.first = (rewind.first + 1) % REWIND_SEGMENTS;
+        rewind.segmentCount--;
+    }
+    RewindSegment& segment = rewind.segments[(rewind.first + rewind.segmentCount++) % REWIND_SEGMENTS];
+    segment.position = rewind.end++;
+    segment.count = 1;
+    segment.used = 0;
+    takeSnapshot(game, segment.keyframe);
+    rewind.latest = segment.keyframe;
+}
+
+/**
+ * Start a history from a state, discarding any history held
+ *
+ * @param rewind - history to start
+ * @param game -   first state of the history
+ */
+void startRewind(Rewind& rewind, const GameState& game)
+{
+    rewind.first = 0;
+    rewind.segmentCount = 0;
+    rewind.start = 0;
+    rewind.end = 0;
+    startSegment(rewind, game);
+}
+
+/**
+ * Record the latest state of a game in its history, if it has changed since the last state recorded
+ * Makes no heap allocation
+ *
+ * @param rewind - history to record in
+ * @param game -   latest state of the game
+ * @return -       true if the state was recorded
+ */
+bool recordRewind(Rewind& rewind, const GameState& game)
+{
+    unsigned char delta[REWIND_DELTA_BYTES];
+    int length = takeDelta(rewind.latest, game, delta);
+    if(length == 0)
+        return false;
+
+    RewindSegment& segment = rewind.segments[(rewind.first + rewind.segmentCount - 1) % REWIND_SEGMENTS];
+    if(segment.count == REWIND_INTERVAL || segment.used + length > REWIND_SEGMENT_BYTES)
+    {
+        startSegment(rewind, game);
+        return true;
+    }
+    memcpy(segment.deltas + segment.used, delta, length);
+    segment.used += length;
+    segment.ends[segment.count - 1] = segment.used;
+    segment.count++;
+    rewind.end++;
+    takeSnapshot(game, rewind.latest);
+    return true;
+}
+
+/**
+ * Find the segment of the history holding a state
+ *
+ * @param rewind -   history to search
+ * @param position - position of the state, which must be held
+ * @return -         index within the ring of the segment holding it
+ */
+int findSegment(const Rewind& rewind, long long position)
+{
+    int s = rewind.segmentCount - 1;    // Search from the newest, as scrubbing starts from the latest state
+    while(s > 0 && rewind.segments[(rewind.first + s) % REWIND_SEGMENTS].position > position)
+        s--;
+    return (rewind.first + s) % REWIND_SEGMENTS;
+}
+
+/**
+ * Reconstruct a state held in the history, from its keyframe and the deltas leading on from it
+ *
+ * @param rewind -   history to seek within
+ * @param position - position of the state, from start to end - 1
+ * @param game -     set to the state, unless it is no longer held
+ * @return -         true if the state is held
+ */
+bool seekRewind(const Rewind& rewind, long long position, GameState& game)
+{
+    if(position < rewind.start || position >= rewind.end)
+        return false;
+    const RewindSegment& segment = rewind.segments[findSegment(rewind, position)];
+    Snapshot state = segment.keyframe;
+    int begin = 0;
+    for(int d = 0; d < position - segment.position; d++)
+    {
+        applyDelta(state, segment.deltas + begin, segment.ends[d] - begin);
+        begin = segment.ends[d];
+    }
+    restoreSnapshot(game, state);
+    return true;
+}
+
+/**
+ * Discard every state after a given state, so that play resumes from it
+ *
+ * @param rewind -   history to cut short
+ * @param position - position of the new latest state, which must be held
+ */
+void truncateRewind(Rewind& rewind, long long position)
+{
+    int s = findSegment(rewind, position);
+    RewindSegment& segment = rewind.segments[s];
+    segment.count = position - segment.position + 1;
+    segment.used = segment.count > 1 ? segment.ends[segment.count - 2] : 0;
+    rewind.segmentCount = (s - rewind.first + REWIND_SEGMENTS) % REWIND_SEGMENTS + 1;
+    rewind.end = position + 1;
+
+    GameState latest;
+    seekRewind(rewind, position, latest);
+    takeSnapshot(latest, rewind.latest);
+}
+
+/**
+ * Get the number of states held in the history
+ *
+ * @param rewind - history
+ * @return -       states held
+ */
+inline long long rewindLength(const Rewind& rewind)
+{
+    return rewind.end - rewind.start;
+}
+
+#endif //PACMAN_REWIND_H
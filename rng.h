@@ -0,0 +1,49 @@
+/**
+ * Header file responsible for random number generation
+ *
+ * Every game owns its own generator, so the same seed always plays out the same game no matter how many games are
+ * run at once, on how many threads, or in which order. The generator is counter-based: each draw hashes the seed and
+ * an incrementing counter with the SplitMix64 mixing function, so it is cheap and needs no locking.
+ */
+
+#ifndef PACMAN_RNG_H
+#define PACMAN_RNG_H
+
+struct Rng
+{
+    uint64_t seed;      // Seed from which the stream of numbers is derived
+    uint64_t counter;   // Number of draws made so far
+
+    Rng(uint64_t seed = 0)
+    {
+        this->seed = seed;
+        counter = 0;
+    }
+
+    /**
+     * Draw the next 64-bit random number in the stream
+     *
+     * @return - uniformly distributed 64-bit random number
+     */
+    uint64_t next()
+    {
+        uint64_t z = seed + ++counter * 0x9E3779B97F4A7C15ULL;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    /**
+     * Draw a random integer in the range [0, n)
+     * Scales the top 32 bits of a draw by multiplication rather than taking a modulus, avoiding a division
+     *
+     * @param n - exclusive upper bound, must be positive
+     * @return -  random integer from 0 to n-1
+     */
+    int nextInt(int n)
+    {
+        return (int)(((next() >> 32) * (uint64_t)n) >> 32);
+    }
+};
+
+#endif //PACMAN_RNG_H
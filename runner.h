@@ -0,0 +1,228 @@
+/**
+ * Header file responsible for running batches of independent headless games across all cores
+ * Each game is played from a seed and an input source (bot or recorded inputs) until GAMEOVER,
+ * with games scheduled onto worker threads by a work-stealing pool
+ */
+
+#ifndef PACMAN_RUNNER_H
+#define PACMAN_RUNNER_H
+
+// A single recorded input, changing Pac-Man's direction on a given tick since the game began
+struct RecordedInput
+{
+    long long tick;
+    direction dir;
+};
+
+/**
+ * Input source standing in for the player of a headless game
+ *      Bot:      when stationary or at the center of a tile, occasionally pick a new random direction
+ *      Recorded: replay a list of recorded inputs, each on the tick it was originally made
+ */
+struct Player
+{
+    bool recorded;                  // True if replaying recorded inputs, false if a bot
+    vector<RecordedInput> inputs;   // Recorded inputs, in tick order
+    size_t next;                    // Index of the next recorded input to apply
+    Rng rng;                        // Bot's random number generator, kept per game so bots don't share a generator
+
+    Player()
+    {
+        recorded = false;
+        next = 0;
+    }
+};
+
+/**
+ * Steer Pac-Man for the coming tick, according to the player's input source
+ *
+ * @param player - input source
+ * @param game -   game in which to steer Pac-Man
+ * @param tick -   ticks since the game began
+ */
+void playerInput(Player& player, GameState& game, long long tick)
+{
+    if(player.recorded)
+    {
+        while(player.next < player.inputs.size() && player.inputs[player.next].tick <= tick)
+            game.pacman.setDirection(player.inputs[player.next++].dir);
+        return;
+    }
+
+    Pacman& pacman = game.pacman;
+    if(game.mode == PLAY && (pacman.getDirection() == NONE || pacman.atTileCenter()) && player.rng.nextInt(4) == 0)
+        pacman.setDirection(static_cast<direction>(player.rng.nextInt(LEFT) + 1));
+}
+
+/**
+ * Load recorded inputs from a text file, consisting of a "seed N" line followed by one "tick direction" line per input
+ * Directions are given as U, R, D or L
+ *
+ * @param filename - file to read
+ * @param player -   player to fill with the recorded inputs
+ * @param seed -     set to the seed the recording was made with
+ * @return -         true if the whole file was read successfully - false if any line is malformed or truncated
+ */
+bool loadInputs(const char* filename, Player& player, unsigned int& seed)
+{
+    ifstream file(filename);
+    string word;
+    if(!(file >> word >> seed) || word != "seed")
+        return false;
+
+    player.recorded = true;
+    player.inputs.clear();
+    player.next = 0;
+
+    RecordedInput input;
+    char d;
+    while(file >> input.tick)
+    {
+        if(!(file >> d))
+            return false;
+        switch(d)
+        {
+            case 'U': input.dir = UP;       break;
+            case 'R': input.dir = RIGHT;    break;
+            case 'D': input.dir = DOWN;     break;
+            case 'L': input.dir = LEFT;     break;
+            default:  return false;
+        }
+        player.inputs.push_back(input);
+    }
+    return file.eof();  // Reading only stops early at a tick that is not a number
+}
+
+// Outcome of a single game played to GAMEOVER
+struct GameResult
+{
+    unsigned int seed;      // Seed the game was played from
+    int score;              // Final score
+    int level;              // Level reached
+    long long ticks;        // Ticks survived
+    int fruits;             // Fruits eaten
+};
+
+/**
+ * Play a single game from a fresh state until GAMEOVER, or until a tick limit is reached
+ *
+ * @param seed -       seed from which to play the game
+ * @param player -     input source steering Pac-Man
+ * @param maxTicks -   maximum ticks to play before giving up on the game
+ * @param pathGhosts - true if the ghosts target by path distance
+ * @return -           result of the game
+ */
+GameResult playGame(unsigned int seed, Player& player, long long maxTicks, bool pathGhosts)
+{
+    TRACE_SPAN("game");
+    GameState game(seed);
+    setPathGhosts(game, pathGhosts);
+    long long tick = 0;
+    while(game.mode != GAMEOVER && tick < maxTicks)
+    {
+        playerInput(player, game, tick);
+        stepGame(game);
+        tick++;
+    }
+
+    GameResult result;
+    result.seed = seed;
+    result.score = game.score;
+    result.level = game.level;
+    result.ticks = tick;
+    result.fruits = game.board.fruits;
+    return result;
+}
+
+/**
+ * Work-stealing thread pool running a fixed number of independent jobs
+ *
+ * Each worker owns a queue of jobs, initially dealt out round-robin. Workers take jobs from the back of their own
+ * queue and, once it is empty, steal from the front of the other workers' queues. This keeps all cores busy even
+ * when some jobs (games) run far longer than others.
+ */
+class WorkStealingPool
+{
+private:
+    // A worker's queue of job indices, guarded by its own lock so workers rarely contend
+    struct Queue
+    {
+        mutex lock;
+        deque<int> jobs;
+    };
+
+    vector<Queue> queues;
+
+    /**
+     * Take the most recently queued job from a worker's own queue
+     *
+     * @param worker - index of the worker
+     * @param job -    set to the job taken
+     * @return -       true if a job was taken
+     */
+    bool pop(int worker, int& job)
+    {
+        lock_guard<mutex> guard(queues[worker].lock);
+        if(queues[worker].jobs.empty())
+            return false;
+        job = queues[worker].jobs.back();
+        queues[worker].jobs.pop_back();
+        return true;
+    }
+
+    /**
+     * Steal the oldest queued job from any other worker's queue
+     *
+     * @param worker - index of the worker stealing
+     * @param job -    set to the job stolen
+     * @return -       true if a job was stolen, false once every queue is empty
+     */
+    bool steal(int worker, int& job)
+    {
+        for(size_t i = 1; i < queues.size(); i++)
+        {
+            Queue& victim = queues[(worker + i) % queues.size()];
+            lock_guard<mutex> guard(victim.lock);
+            if(!victim.jobs.empty())
+            {
+                job = victim.jobs.front();
+                victim.jobs.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+public:
+    /**
+     * @param threads - number of worker threads
+     */
+    WorkStealingPool(int threads) : queues(max(threads, 1)) {}
+
+    /**
+     * Run every job to completion, returning once all are done
+     *
+     * @param jobs - number of jobs, numbered 0 to jobs-1
+     * @param work - function run for each job, given the job and worker index
+     */
+    void run(int jobs, function<void(int, int)> work)
+    {
+        for(int i = 0; i < jobs; i++)
+            queues[i % queues.size()].jobs.push_back(i);
+
+        vector<thread> workers;
+        for(size_t w = 0; w < queues.size(); w++)
+        {
+            workers.push_back(thread([this, w, &work]()
+            {
+                int job;
+                while(pop(w, job) || steal(w, job))
+                    work(job, w);
+            }));
+        }
+        for(size_t w = 0; w < workers.size(); w++)
+            workers[w].join();
+    }
+};
+
+#endif //PACMAN_RUNNER_H
@@ -0,0 +1,105 @@
+/**
+ * Header file responsible for save states - snapshots of the whole state of a game, which can be restored at any point
+ *
+ * Everything a game needs to carry on from where it was - the board, Pac-Man, the ghosts, the game's counters and its
+ * random number generator - is held by value within its GameState, which holds no pointers and is trivially copyable.
+ * A snapshot is therefore simply the bytes of a GameState, taken and restored with a single memcpy, so search bots and
+ * test harnesses can branch from any tick rather than replaying from the first. The tables built at startup (see
+ * map.h and paths.h) never change during a game, and are not part of a snapshot.
+ *
+ * A save state file is laid out as:
+ *      Header:   magic, version, and the size of the snapshot following
+ *      Snapshot: the bytes of the GameState
+ * As the snapshot is the GameState's own layout, SAVESTATE_VERSION must be bumped whenever any part of the state
+ * changes, and a file is only read by a build of the same version, size and byte order as the one that wrote it.
+ */
+
+#ifndef PACMAN_SAVESTATE_H
+#define PACMAN_SAVESTATE_H
+
+static_assert(is_trivially_copyable<GameState>::value, "GameState must be trivially copyable to be snapshot");
+
+const char SAVESTATE_MAGIC[4] = {'P', 'M', 'S', 'S'};
+const uint32_t SAVESTATE_VERSION = 1;
+const char* const SAVESTATE_FILE = "savestate.pmss";    // File the windowed game saves its state to
+
+// The whole state of a game, as raw bytes
+struct Snapshot
+{
+    alignas(GameState) unsigned char bytes[sizeof(GameState)];
+};
+
+struct SaveStateHeader
+{
+    char magic[4];      // SAVESTATE_MAGIC
+    uint32_t version;   // SAVESTATE_VERSION
+    uint32_t size;      // Size of the snapshot, in bytes
+};
+
+/**
+ * Take a snapshot of a game
+ *
+ * @param game -     game to snapshot
+ * @param snapshot - set to the state of the game
+ */
+inline void takeSnapshot(const GameState& game, Snapshot& snapshot)
+{
+    memcpy(snapshot.bytes, &game, sizeof(GameState));
+}
+
+/**
+ * Restore a game to a snapshot, which need not have been taken of the same game
+ *
+ * @param game -     game to restore
+ * @param snapshot - state to restore the game to
+ */
+inline void restoreSnapshot(GameState& game, const Snapshot& snapshot)
+{
+    memcpy(&game, snapshot.bytes, sizeof(GameState));
+}
+
+/**
+ * Write a snapshot to a file
+ *
+ * @param filename - file to write
+ * @param snapshot - snapshot to write
+ * @return -         true if the whole snapshot was written
+ */
+bool writeSaveState(const char* filename, const Snapshot& snapshot)
+{
+    SaveStateHeader header;
+    memcpy(header.magic, SAVESTATE_MAGIC, 4);
+    header.version = SAVESTATE_VERSION;
+    header.size = sizeof(snapshot.bytes);
+
+    FILE* file = fopen(filename, "wb");
+    if(file == NULL)
+        return false;
+    bool written = fwrite(&header, sizeof(header), 1, file) == 1 && fwrite(snapshot.bytes, sizeof(snapshot.bytes), 1, file) == 1;
+    return fclose(file) == 0 && written;
+}
+
+/**
+ * Read a snapshot from a file
+ *
+ * @param filename - file to read
+ * @param snapshot - set to the snapshot read, only if the whole file is valid
+ * @return -         false if the file is missing, or is not a complete save state of this version and size
+ */
+bool readSaveState(const char* filename, Snapshot& snapshot)
+{
+    FILE* file = fopen(filename, "rb");
+    if(file == NULL)
+        return false;
+    SaveStateHeader header;
+    Snapshot read;
+    bool valid = fread(&header, sizeof(header), 1, file) == 1 && memcmp(header.magic, SAVESTATE_MAGIC, 4) == 0 &&
+                 header.version == SAVESTATE_VERSION && header.size == sizeof(read.bytes) &&
+                 fread(read.bytes, sizeof(read.bytes), 1, file) == 1;
+    fclose(file);
+    if(valid)
+        snapshot = read;
+    return valid;
+}
+
+#endif //PACMAN_SAVESTATE_H
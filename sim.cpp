@@ -0,0 +1,702 @@
+/**
+ * Headless simulation of the game, stepping the game logic with no window, no rendering and no frame rate cap.
+ *
+ * The following modes are supported:
+ *      Benchmark:   step a number of games, held contiguously in a single array, in turn for a given number of ticks,
+ *                   restarting each whenever it is over, and report the achieved tick rate
+ *      Batch:       play many independent games to GAMEOVER across all cores using a work-stealing pool,
+ *                   reporting per-game results along with aggregate throughput
+ *      Alloc check: step games as the benchmark does, failing if any tick makes a heap allocation
+ *      Snapshots:   step games as the benchmark does, timing snapshots of them taken and restored (see savestate.h),
+ *                   failing if two branches played from the same snapshot ever differ
+ *      MCTS:        play games to GAMEOVER one after another with the MCTS autoplayer (see mcts.h) steering Pac-Man,
+ *                   searching each decision on every thread, reporting per-game results and rollouts per second
+ *      Rewind:      play games as the benchmark does, recording each into a rewind history (see rewind.h), failing if
+ *                   seeking to any state held, before or after cutting the history short, reconstructs it wrongly
+ *      Replay:      play back replays recorded by the windowed game (see replay.h) across all cores, failing if any
+ *                   ends with a score or level other than recorded
+ *
+ * Usage: ./pacman_sim [--ticks N] [--games N] [--seed N]
+ *        ./pacman_sim --batch N [--threads N] [--seed N] [--max-ticks N] [--quiet]
+ *        ./pacman_sim --inputs FILE... [--threads N] [--max-ticks N] [--quiet]
+ *        ./pacman_sim --check-allocs [--ticks N] [--games N] [--seed N]
+ *        ./pacman_sim --check-snapshots [--ticks N] [--games N] [--seed N]
+ *        ./pacman_sim --check-rewind [--ticks N] [--games N] [--seed N]
+ *        ./pacman_sim --mcts N [--threads N] [--budget MS] [--rollouts N] [--seed N] [--max-ticks N] [--quiet]
+ *        ./pacman_sim --replay FILE... [--threads N] [--quiet]
+ * Any mode also accepts --path-ghosts, making the ghosts target by path distance through the maze, and, if built with
+ * tracing (see trace.h), --trace FILE, writing the spans and events recorded by the run to FILE as Chrome trace JSON
+ * If built with hardware counters (see perf.h), every mode also reports the events counted in each phase of a tick
+ */
+
+// Compile out all drawing code from the game headers - nothing here links against GL or GLUT
+#define PACMAN_HEADLESS
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <limits.h>
+#include <string.h>
+#include <cmath>
+#include <vector>
+#include <deque>
+#include <string>
+#include <fstream>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <new>
+#include <type_traits>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#ifdef PACMAN_PERF
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+using namespace std;    // No need to write std::-bla all the time
+using namespace std::chrono;    // No need to write std::chrono::-bla all the time
+
+// Custom header files
+#include "types.h"
+#include "rng.h"
+#include "profile.h"
+#include "trace.h"
+#include "perf.h"
+#include "map.h"
+#include "paths.h"
+#include "pacman.h"
+#include "ghosts.h"
+#include "globals.h"
+#include "replay.h"
+#include "savestate.h"
+#include "rewind.h"
+#include "mcts.h"
+#include "runner.h"
+
+// Number of heap allocations made so far, counted by the replacement operator new below
+atomic<long long> allocations(0);
+
+/**
+ * Replacement global allocation functions, counting every heap allocation made by the program
+ * Array forms and sized deallocation default to calling these
+ */
+void* operator new(size_t size)
+{
+    allocations++;
+    void* p = malloc(size > 0 ? size : 1);
+    if(p == NULL)
+        throw bad_alloc();
+    return p;
+}
+void operator delete(void* p) noexcept
+{
+    free(p);
+}
+
+/**
+ * Benchmark mode: step every game for the requested number of ticks, restarting each game whenever it is over
+ *
+ * @param maxTicks -   ticks to step each game
+ * @param gameCount -  number of games to hold and step at once
+ * @param seed -       seed from which the bots' seeds are derived
+ * @param pathGhosts - true if the ghosts target by path distance
+ */
+void runBenchmark(long long maxTicks, int gameCount, unsigned int seed, bool pathGhosts)
+{
+    vector<GameState> games(gameCount);     // Every game is held contiguously, rather than in its own process
+    vector<Player> players(gameCount);
+    vector<long long> gameTicks(gameCount, 0);
+    for(int g = 0; g < gameCount; g++)
+    {
+        games[g].rng = Rng(seed + g);
+        setPathGhosts(games[g], pathGhosts);
+        players[g].rng = Rng(~(uint64_t)(seed + g));    // Bot draws from its own stream, independent of the game's
+    }
+
+    long long gamesOver = 0;                // Number of games played to GAMEOVER
+    long long totalScore = 0;               // Sum of final scores, used to report the average
+
+    steady_clock::time_point start = steady_clock::now();
+    for(long long i = 0; i < maxTicks; i++)
+    {
+        for(int g = 0; g < gameCount; g++)
+        {
+            GameState& game = games[g];
+            playerInput(players[g], game, gameTicks[g]++);
+            stepGame(game);
+            if(game.mode == GAMEOVER)   // Restart immediately, as pressing a key would in the window
+            {
+                gamesOver++;
+                totalScore += game.score;
+                restartGame(game);
+                gameTicks[g] = 0;
+            }
+        }
+    }
+    double seconds = duration<double>(steady_clock::now() - start).count();
+    double totalTicks = (double)maxTicks * gameCount;
+
+    printf("games:      %d (%d bytes each)\n", gameCount, (int)sizeof(GameState));
+    printf("ticks:      %.0f\n", totalTicks);
+    printf("seconds:    %.3f\n", seconds);
+    printf("ticks/sec:  %.0f\n", totalTicks / seconds);
+    printf("game overs: %lld\n", gamesOver);
+    if(gamesOver > 0)
+        printf("avg score:  %.1f\n", (double)totalScore / gamesOver);
+    printPerfCounters(totalTicks);
+}
+
+/**
+ * Alloc check mode: step every game as the benchmark does, asserting that no tick makes a heap allocation
+ * Games are allocated up front - only the ticks themselves are checked
+ *
+ * @param maxTicks -   ticks to step each game
+ * @param gameCount -  number of games to hold and step at once
+ * @param seed -       seed from which the games' and bots' seeds are derived
+ * @param pathGhosts - true if the ghosts target by path distance
+ * @return -           true if every tick was allocation free
+ */
+bool runAllocCheck(long long maxTicks, int gameCount, unsigned int seed, bool pathGhosts)
+{
+    vector<GameState> games(gameCount);
+    vector<Player> players(gameCount);
+    vector<long long> gameTicks(gameCount, 0);
+    for(int g = 0; g < gameCount; g++)
+    {
+        games[g].rng = Rng(seed + g);
+        setPathGhosts(games[g], pathGhosts);
+        players[g].rng = Rng(~(uint64_t)(seed + g));
+    }
+
+    for(long long i = 0; i < maxTicks; i++)
+    {
+        for(int g = 0; g < gameCount; g++)
+        {
+            GameState& game = games[g];
+            long long before = allocations;
+            playerInput(players[g], game, gameTicks[g]++);
+            stepGame(game);
+            if(game.mode == GAMEOVER)
+            {
+                restartGame(game);
+                gameTicks[g] = 0;
+            }
+            if(allocations != before)
+            {
+                printf("FAIL: game %d made %lld heap allocations on tick %lld\n", g, allocations - before, gameTicks[g]);
+                return false;
+            }
+        }
+    }
+
+    printf("PASS: 0 heap allocations in %lld ticks\n", maxTicks * gameCount);
+    printPerfCounters(maxTicks * gameCount);
+    return true;
+}
+
+/**
+ * Snapshot check mode: step every game as the benchmark does, snapshotting every game on every tick and restoring
+ * each into a branch, every so often playing a pair of branches on from the same snapshot to check they stay identical
+ *
+ * @param maxTicks -   ticks to step each game
+ * @param gameCount -  number of games to hold and step at once
+ * @param seed -       seed from which the games' and bots' seeds are derived
+ * @param pathGhosts - true if the ghosts target by path distance
+ * @return -           true if every pair of branches stayed identical
+ */
+bool runSnapshotCheck(long long maxTicks, int gameCount, unsigned int seed, bool pathGhosts)
+{
+    const int BRANCH_INTERVAL = 1000;   // Ticks between branches played on
+    const int BRANCH_TICKS = 300;       // Ticks each branch is played on for
+
+    vector<GameState> games(gameCount);
+    vector<Player> players(gameCount);
+    vector<long long> gameTicks(gameCount, 0);
+    vector<Snapshot> snapshots(gameCount);
+    vector<GameState> branches(gameCount);
+    for(int g = 0; g < gameCount; g++)
+    {
+        games[g].rng = Rng(seed + g);
+        setPathGhosts(games[g], pathGhosts);
+        players[g].rng = Rng(~(uint64_t)(seed + g));
+    }
+
+    steady_clock::duration takeTime(0);
+    steady_clock::duration restoreTime(0);
+    long long branchesChecked = 0;
+    for(long long i = 0; i < maxTicks; i++)
+    {
+        // Snapshot and restore every game at once, timing each pass over the games as a whole
+        steady_clock::time_point start = steady_clock::now();
+        for(int g = 0; g < gameCount; g++)
+            takeSnapshot(games[g], snapshots[g]);
+        steady_clock::time_point taken = steady_clock::now();
+        for(int g = 0; g < gameCount; g++)
+            restoreSnapshot(branches[g], snapshots[g]);
+        restoreTime += steady_clock::now() - taken;
+        takeTime += taken - start;
+
+        if(i % BRANCH_INTERVAL == 0)
+        {
+            // A restored game must play on exactly as the game it was taken of - both branches start as the same bytes,
+            // so any difference in their bytes after playing on is a difference in state
+            for(int g = 0; g < gameCount; g++)
+            {
+                GameState other;
+                restoreSnapshot(other, snapshots[g]);
+                for(int t = 0; t < BRANCH_TICKS; t++)
+                {
+                    stepGame(branches[g]);
+                    stepGame(other);
+                }
+                if(memcmp(&branches[g], &other, sizeof(GameState)) != 0)
+                {
+                    printf("FAIL: branches of game %d from tick %lld differ after %d ticks\n", g, gameTicks[g], BRANCH_TICKS);
+                    return false;
+                }
+                branchesChecked++;
+            }
+        }
+
+        for(int g = 0; g < gameCount; g++)
+        {
+            GameState& game = games[g];
+            playerInput(players[g], game, gameTicks[g]++);
+            stepGame(game);
+            if(game.mode == GAMEOVER)
+            {
+                restartGame(game);
+                gameTicks[g] = 0;
+            }
+        }
+    }
+
+    double snapshotsTaken = (double)maxTicks * gameCount;
+    printf("snapshot:   %d bytes\n", (int)sizeof(Snapshot));
+    printf("take:       %.1f ns\n", duration<double, nano>(takeTime).count() / snapshotsTaken);
+    printf("restore:    %.1f ns\n", duration<double, nano>(restoreTime).count() / snapshotsTaken);
+    printf("PASS: %lld pairs of branches identical after %d ticks\n", branchesChecked, BRANCH_TICKS);
+    return true;
+}
+
+/**
+ * Check that every state held in a rewind history is reconstructed exactly as recorded
+ *
+ * @param rewind - history to check
+ * @param states - every state recorded, indexed by position modulo its size
+ * @param seekTime - increased by the time taken seeking
+ * @return -       position of the first state reconstructed wrongly, or -1 if none
+ */
+long long checkRewind(const Rewind& rewind, const vector<Snapshot>& states, steady_clock::duration& seekTime)
+{
+    GameState state;
+    for(long long p = rewind.start; p < rewind.end; p++)
+    {
+        steady_clock::time_point start = steady_clock::now();
+        seekRewind(rewind, p, state);
+        seekTime += steady_clock::now() - start;
+        if(memcmp(&state, states[p % states.size()].bytes, sizeof(GameState)) != 0)
+            return p;
+    }
+    return -1;
+}
+
+/**
+ * Rewind check mode: play each game in turn, recording every state into a rewind history, then seek to every state
+ * held - once as recorded, and again after cutting the history short half way and playing on - checking each against
+ * a full snapshot of the state recorded
+ *
+ * @param maxTicks -   ticks to step each game
+ * @param gameCount -  number of games to play
+ * @param seed -       seed from which the games' and bots' seeds are derived
+ * @param pathGhosts - true if the ghosts target by path distance
+ * @return -           true if every state was reconstructed exactly
+ */
+bool runRewindCheck(long long maxTicks, int gameCount, unsigned int seed, bool pathGhosts)
+{
+    Rewind* rewind = new Rewind();
+    vector<Snapshot> states(REWIND_SEGMENTS * REWIND_INTERVAL + 1);    // Every state the history can hold
+    steady_clock::duration recordTime(0);
+    steady_clock::duration seekTime(0);
+    long long recorded = 0;
+    long long seeks = 0;
+    long long held = 0;
+
+    for(int g = 0; g < gameCount; g++)
+    {
+        GameState game(seed + g);
+        setPathGhosts(game, pathGhosts);
+        Player player;
+        player.rng = Rng(~(uint64_t)(seed + g));
+        long long gameTicks = 0;
+        startRewind(*rewind, game);
+        takeSnapshot(game, states[0]);
+
+        for(int pass = 0; pass < 2; pass++)
+        {
+            for(long long i = 0; i < (pass == 0 ? maxTicks : maxTicks / 2); i++)
+            {
+                playerInput(player, game, gameTicks++);
+                stepGame(game);
+                if(game.mode == GAMEOVER)
+                {
+                    restartGame(game);
+                    gameTicks = 0;
+                }
+                steady_clock::time_point start = steady_clock::now();
+                bool changed = recordRewind(*rewind, game);
+                recordTime += steady_clock::now() - start;
+                if(changed)
+                {
+                    takeSnapshot(game, states[(rewind->end - 1) % states.size()]);
+                    recorded++;
+                }
+            }
+
+            held = max(held, rewindLength(*rewind));
+            long long wrong = checkRewind(*rewind, states, seekTime);
+            seeks += rewindLength(*rewind);
+            if(wrong != -1)
+            {
+                printf("FAIL: game %d reconstructed state %lld wrongly%s\n", g, wrong, pass > 0 ? " after cutting short" : "");
+                delete rewind;
+                return false;
+            }
+
+            // Cut the history short half way, then play on from there on the second pass
+            long long position = rewind->start + rewindLength(*rewind) / 2;
+            truncateRewind(*rewind, position);
+            seekRewind(*rewind, position, game);
+        }
+    }
+
+    printf("history:    %d bytes, %d states over %d segments\n", (int)sizeof(Rewind), REWIND_SEGMENTS * REWIND_INTERVAL,
+           REWIND_SEGMENTS);
+    printf("held:       %lld states at most\n", held);
+    printf("record:     %.1f ns\n", duration<double, nano>(recordTime).count() / max(recorded, 1LL));
+    printf("seek:       %.1f ns\n", duration<double, nano>(seekTime).count() / max(seeks, 1LL));
+    printf("PASS: %lld states recorded, %lld seeks exact\n", recorded, seeks);
+    delete rewind;
+    return true;
+}
+
+/**
+ * MCTS mode: play each game to GAMEOVER in turn with the MCTS autoplayer steering Pac-Man, then report per-game
+ * results, the work done by the searches, and the average score as a reference for the level's difficulty
+ *
+ * @param gameCount -  number of games to play
+ * @param config -     configuration of the autoplayer's searches
+ * @param seed -       seed of the first game, each following game seeded one higher
+ * @param maxTicks -   maximum ticks to play any one game
+ * @param pathGhosts - true if the ghosts target by path distance
+ * @param quiet -      if true, only report the aggregate results
+ */
+void runMcts(int gameCount, const MctsConfig& config, unsigned int seed, long long maxTicks, bool pathGhosts, bool quiet)
+{
+    MctsBot* bot = new MctsBot();
+    bot->config = config;
+    long long totalTicks = 0;
+    long long totalScore = 0;
+
+    steady_clock::time_point start = steady_clock::now();
+    if(!quiet)
+        printf("%8s %12s %8s %6s %10s %6s\n", "game", "seed", "score", "level", "ticks", "fruits");
+    for(int g = 0; g < gameCount; g++)
+    {
+        GameState game(seed + g);
+        setPathGhosts(game, pathGhosts);
+        long long tick = 0;
+        while(game.mode != GAMEOVER && tick < maxTicks)
+        {
+            direction d = mctsDecide(*bot, game);
+            if(d != NONE)
+                game.pacman.setDirection(d);
+            stepGame(game);
+            tick++;
+        }
+        if(!quiet)
+            printf("%8d %12u %8d %6d %10lld %6d\n", g, seed + g, game.score, game.level, tick, game.board.fruits);
+        totalTicks += tick;
+        totalScore += game.score;
+    }
+    double seconds = duration<double>(steady_clock::now() - start).count();
+
+    printf("games:      %d\n", gameCount);
+    printf("threads:    %d\n", config.threads);
+    printf("seconds:    %.3f\n", seconds);
+    printMctsStats(*bot);
+    printf("avg score:  %.1f\n", (double)totalScore / max(gameCount, 1));
+    printPerfCounters(totalTicks);
+    delete bot;
+}
+
+/**
+ * Batch mode: play every game to GAMEOVER on a work-stealing pool, then report per-game results and throughput
+ *
+ * @param seeds -      seed of each game
+ * @param players -    input source of each game
+ * @param threads -    number of worker threads
+ * @param maxTicks -   maximum ticks to play any one game
+ * @param pathGhosts - true if the ghosts target by path distance
+ * @param quiet -      if true, only report the aggregate results
+ */
+void runBatch(vector<unsigned int>& seeds, vector<Player>& players, int threads, long long maxTicks, bool pathGhosts, bool quiet)
+{
+    int gameCount = seeds.size();
+    vector<GameResult> results(gameCount);
+
+    steady_clock::time_point start = steady_clock::now();
+    WorkStealingPool pool(threads);
+    pool.run(gameCount, [&](int job, int)
+    {
+        results[job] = playGame(seeds[job], players[job], maxTicks, pathGhosts);
+    });
+    double seconds = duration<double>(steady_clock::now() - start).count();
+
+    long long totalTicks = 0;
+    long long totalScore = 0;
+    if(!quiet)
+        printf("%8s %12s %8s %6s %10s %6s\n", "game", "seed", "score", "level", "ticks", "fruits");
+    for(int g = 0; g < gameCount; g++)
+    {
+        GameResult& r = results[g];
+        if(!quiet)
+            printf("%8d %12u %8d %6d %10lld %6d\n", g, r.seed, r.score, r.level, r.ticks, r.fruits);
+        totalTicks += r.ticks;
+        totalScore += r.score;
+    }
+
+    printf("games:      %d\n", gameCount);
+    printf("threads:    %d\n", threads);
+    printf("seconds:    %.3f\n", seconds);
+    printf("games/sec:  %.1f\n", gameCount / seconds);
+    printf("ticks/sec:  %.0f\n", totalTicks / seconds);
+    printf("avg score:  %.1f\n", (double)totalScore / max(gameCount, 1));
+    printPerfCounters(totalTicks);
+}
+
+/**
+ * Replay mode: play back every replay on a work-stealing pool, checking each ends as it did when recorded
+ * Each replay carries its own seed and options
+ *
+ * @param replays - replays to play back
+ * @param files -   file each replay was read from
+ * @param threads - number of worker threads
+ * @param quiet -   if true, only report the aggregate results
+ * @return -        true if every replay matched its recording
+ */
+bool runReplays(vector<Replay>& replays, vector<const char*>& files, int threads, bool quiet)
+{
+    int replayCount = replays.size();
+    vector<GameState> games(replayCount);
+
+    steady_clock::time_point start = steady_clock::now();
+    WorkStealingPool pool(threads);
+    pool.run(replayCount, [&](int job, int)
+    {
+        playReplay(replays[job], games[job]);
+    });
+    double seconds = duration<double>(steady_clock::now() - start).count();
+
+    long long totalTicks = 0;
+    int mismatches = 0;
+    if(!quiet)
+        printf("%-24s %20s %8s %6s %10s %s\n", "replay", "seed", "score", "level", "ticks", "result");
+    for(int r = 0; r < replayCount; r++)
+    {
+        const ReplayHeader& header = replays[r].header;
+        bool match = games[r].score == header.score && games[r].level == header.level;
+        if(!match)
+            mismatches++;
+        if(!quiet || !match)
+            printf("%-24s %20llu %8d %6d %10lld %s\n", files[r], (unsigned long long)header.seed, games[r].score,
+                   games[r].level, (long long)header.ticks, match ? "match" : "MISMATCH");
+        totalTicks += header.ticks;
+    }
+
+    printf("replays:    %d\n", replayCount);
+    printf("mismatches: %d\n", mismatches);
+    printf("threads:    %d\n", threads);
+    printf("seconds:    %.3f\n", seconds);
+    printf("ticks/sec:  %.0f\n", totalTicks / seconds);
+    printPerfCounters(totalTicks);
+    return mismatches == 0;
+}
+
+/**
+ * Finish a run, writing out its trace if one was requested
+ *
+ * @param status -    exit status of the run
+ * @param traceFile - file to write the trace to, or NULL
+ * @return -          exit status, failing if the trace could not be written
+ */
+int endRun(int status, const char* traceFile)
+{
+#ifdef PACMAN_TRACE
+    if(traceFile != NULL && !writeTrace(traceFile))
+    {
+        fprintf(stderr, "Failed to write trace to %s\n", traceFile);
+        return 1;
+    }
+#endif
+    return status;
+}
+
+/**
+ * Parse the command line and run the requested mode
+ */
+int main(int argc, char* argv[])
+{
+    long long maxTicks = -1;
+    int gameCount = 1;
+    int batch = 0;
+    unsigned int seed = 1;
+    int threads = max((int)thread::hardware_concurrency(), 1);
+    bool quiet = false;
+    bool checkAllocs = false;
+    bool checkSnapshots = false;
+    bool checkRewind = false;
+    int mctsGames = 0;
+    MctsConfig mctsConfig;
+    bool pathGhosts = false;
+    const char* traceFile = NULL;
+    vector<const char*> inputFiles;
+    vector<const char*> replayFiles;
+
+    for(int i = 1; i < argc; i++)
+    {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if((arg == "--ticks" || arg == "--max-ticks") && hasValue)
+            maxTicks = atoll(argv[++i]);
+        else if(arg == "--games" && hasValue)
+            gameCount = max(atoi(argv[++i]), 1);
+        else if(arg == "--seed" && hasValue)
+            seed = (unsigned int)strtoul(argv[++i], NULL, 10);
+        else if(arg == "--batch" && hasValue)
+            batch = max(atoi(argv[++i]), 1);
+        else if(arg == "--threads" && hasValue)
+            threads = max(atoi(argv[++i]), 1);
+        else if(arg == "--quiet")
+            quiet = true;
+        else if(arg == "--check-allocs")
+            checkAllocs = true;
+        else if(arg == "--check-snapshots")
+            checkSnapshots = true;
+        else if(arg == "--check-rewind")
+            checkRewind = true;
+        else if(arg == "--mcts" && hasValue)
+            mctsGames = max(atoi(argv[++i]), 1);
+        else if(arg == "--budget" && hasValue)
+            mctsConfig.budget = max(atof(argv[++i]), 0.0);
+        else if(arg == "--rollouts" && hasValue)
+            mctsConfig.rollouts = max(atoll(argv[++i]), 0LL);
+        else if(arg == "--path-ghosts")
+            pathGhosts = true;
+        else if(arg == "--trace" && hasValue)
+            traceFile = argv[++i];
+        else if(arg == "--inputs")
+        {
+            while(i + 1 < argc && strncmp(argv[i + 1], "--", 2) != 0)
+                inputFiles.push_back(argv[++i]);
+        }
+        else if(arg == "--replay")
+        {
+            while(i + 1 < argc && strncmp(argv[i + 1], "--", 2) != 0)
+                replayFiles.push_back(argv[++i]);
+        }
+        else
+        {
+            fprintf(stderr, "Usage: %s [--ticks N] [--games N] [--seed N]\n", argv[0]);
+            fprintf(stderr, "       %s --batch N [--threads N] [--seed N] [--max-ticks N] [--quiet]\n", argv[0]);
+            fprintf(stderr, "       %s --inputs FILE... [--threads N] [--max-ticks N] [--quiet]\n", argv[0]);
+            fprintf(stderr, "       %s --check-allocs [--ticks N] [--games N] [--seed N]\n", argv[0]);
+            fprintf(stderr, "       %s --check-snapshots [--ticks N] [--games N] [--seed N]\n", argv[0]);
+            fprintf(stderr, "       %s --check-rewind [--ticks N] [--games N] [--seed N]\n", argv[0]);
+            fprintf(stderr, "       %s --mcts N [--threads N] [--budget MS] [--rollouts N] [--seed N] [--max-ticks N] [--quiet]\n",
+                    argv[0]);
+            fprintf(stderr, "       %s --replay FILE... [--threads N] [--quiet]\n", argv[0]);
+            fprintf(stderr, "Any mode also accepts --path-ghosts and --trace FILE\n");
+            return 1;
+        }
+    }
+#ifdef PACMAN_PERF
+    perfCounters(); // Open this thread's hardware counters up front, rather than on the first tick
+#endif
+#ifdef PACMAN_TRACE
+    traceThread();  // Create this thread's trace buffer up front, rather than on the first tick
+#else
+    if(traceFile != NULL)
+    {
+        fprintf(stderr, "Tracing is not compiled in - rebuild with TRACE=-DPACMAN_TRACE\n");
+        return 1;
+    }
+#endif
+
+    if(checkAllocs)
+        return endRun(runAllocCheck(maxTicks < 0 ? 1000000 : maxTicks, gameCount, seed, pathGhosts) ? 0 : 1, traceFile);
+
+    if(checkSnapshots)
+        return endRun(runSnapshotCheck(maxTicks < 0 ? 100000 : maxTicks, gameCount, seed, pathGhosts) ? 0 : 1, traceFile);
+
+    if(mctsGames > 0)
+    {
+        mctsConfig.threads = threads;
+        mctsConfig.seed = seed;
+        runMcts(mctsGames, mctsConfig, seed, maxTicks < 0 ? 1000000 : maxTicks, pathGhosts, quiet);
+        return endRun(0, traceFile);
+    }
+
+    if(checkRewind)
+        return endRun(runRewindCheck(maxTicks < 0 ? 20000 : maxTicks, gameCount, seed, pathGhosts) ? 0 : 1, traceFile);
+
+    if(!replayFiles.empty())
+    {
+        vector<Replay> replays(replayFiles.size());
+        for(size_t f = 0; f < replayFiles.size(); f++)
+        {
+            if(!readReplay(replayFiles[f], replays[f]))
+            {
+                fprintf(stderr, "Failed to read replay from %s\n", replayFiles[f]);
+                return 1;
+            }
+        }
+        return endRun(runReplays(replays, replayFiles, threads, quiet) ? 0 : 1, traceFile);
+    }
+
+    if(batch == 0 && inputFiles.empty())
+    {
+        runBenchmark(maxTicks < 0 ? 1000000 : maxTicks, gameCount, seed, pathGhosts);
+        return endRun(0, traceFile);
+    }
+
+    // Batch mode - one game per seed with a bot, plus one game per recorded input file
+    vector<unsigned int> seeds;
+    vector<Player> players;
+    for(int g = 0; g < batch; g++)
+    {
+        seeds.push_back(seed + g);
+        players.push_back(Player());
+        players.back().rng = Rng(~(uint64_t)(seed + g));   // Bot draws from its own stream, independent of the game's
+    }
+    for(size_t f = 0; f < inputFiles.size(); f++)
+    {
+        unsigned int inputSeed;
+        players.push_back(Player());
+        if(!loadInputs(inputFiles[f], players.back(), inputSeed))
+        {
+            fprintf(stderr, "Failed to read recorded inputs from %s\n", inputFiles[f]);
+            return 1;
+        }
+        seeds.push_back(inputSeed);
+    }
+
+    runBatch(seeds, players, threads, maxTicks < 0 ? 1000000 : maxTicks, pathGhosts, quiet);
+    return endRun(0, traceFile);
+}
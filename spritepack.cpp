@@ -0,0 +1,158 @@
+/**
+ * Offline sprite packer, decoding PNG sprites and packing them into atlas pages, written out as a single sprite pack
+ * (see pack.h) for the game to map into memory at startup in place of decoding every PNG file.
+ *
+ * Sprites are packed exactly as the game packs them itself when no pack is present (see atlas.h), and are indexed by
+ * the file names given, which must match those the game registers (e.g. sprites/map/map.png).
+ *
+ * Usage: ./spritepack OUTPUT [--premultiply] FILE...
+ *      --premultiply: store colours pre-multiplied by alpha, which the game then blends accordingly
+ */
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <png.h>
+#include <vector>
+#include <string>
+#include <algorithm>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+using namespace std;    // No need to write std::-bla all the time
+
+// Lab header files
+#include "png_load.h"
+
+// Custom header files
+#include "atlas.h"
+#include "pack.h"
+
+/**
+ * Multiply the colour of every pixel of a page by its alpha, rounding to nearest
+ *
+ * @param page - RGBA pixels of the page
+ */
+void premultiply(vector<unsigned char>& page)
+{
+    for(size_t i = 0; i < page.size(); i += 4)
+    {
+        for(int c = 0; c < 3; c++)
+            page[i + c] = (page[i + c] * page[i + 3] + 127) / 255;
+    }
+}
+
+/**
+ * Write a packed atlas out as a sprite pack
+ *
+ * @param filename -      file to write
+ * @param atlas -         packed atlas, with its pages filled
+ * @param names -         file name of each sprite, indexed by identifier
+ * @param premultiplied - true if the pages' colours are pre-multiplied by alpha
+ * @return -              true if the whole pack was written
+ */
+bool writePack(const char* filename, const Atlas& atlas, const vector<const char*>& names, bool premultiplied)
+{
+    PackHeader header;
+    memcpy(header.magic, PACK_MAGIC, 4);
+    header.version = PACK_VERSION;
+    header.flags = premultiplied ? PACK_PREMULTIPLIED : 0;
+    header.pageSize = ATLAS_PAGE_SIZE;
+    header.pageCount = atlas.pages.size();
+    header.spriteCount = atlas.sprites.size();
+    uint64_t indexEnd = sizeof(PackHeader) + (uint64_t)header.spriteCount * sizeof(PackEntry);
+    header.pagesOffset = (indexEnd + PACK_ALIGNMENT - 1) / PACK_ALIGNMENT * PACK_ALIGNMENT;
+
+    vector<PackEntry> entries(atlas.sprites.size());
+    for(size_t i = 0; i < entries.size(); i++)
+    {
+        const AtlasSprite& sprite = atlas.sprites[i];
+        memset(entries[i].name, 0, PACK_NAME_LENGTH);
+        strncpy(entries[i].name, names[i], PACK_NAME_LENGTH - 1);
+        entries[i].page = sprite.page;
+        entries[i].x = sprite.x;
+        entries[i].y = sprite.y;
+        entries[i].width = sprite.width;
+        entries[i].height = sprite.height;
+    }
+
+    FILE* file = fopen(filename, "wb");
+    if(file == NULL)
+        return false;
+    vector<char> padding(header.pagesOffset - indexEnd, 0);
+    bool written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                   fwrite(&entries[0], sizeof(PackEntry), entries.size(), file) == entries.size() &&
+                   fwrite(padding.data(), 1, padding.size(), file) == padding.size();
+    for(size_t p = 0; p < atlas.pages.size() && written; p++)
+        written = fwrite(&atlas.pages[p][0], 1, atlas.pages[p].size(), file) == atlas.pages[p].size();
+    return fclose(file) == 0 && written;
+}
+
+/**
+ * Parse the command line, then decode, pack and write every sprite given
+ */
+int main(int argc, char* argv[])
+{
+    const char* output = NULL;
+    bool premultiplied = false;
+    vector<const char*> names;
+    for(int i = 1; i < argc; i++)
+    {
+        if(strcmp(argv[i], "--premultiply") == 0)
+            premultiplied = true;
+        else if(output == NULL)
+            output = argv[i];
+        else
+            names.push_back(argv[i]);
+    }
+    if(output == NULL || names.empty())
+    {
+        fprintf(stderr, "Usage: %s OUTPUT [--premultiply] FILE...\n", argv[0]);
+        return 1;
+    }
+
+    Atlas atlas;
+    vector<char*> pixels(names.size(), NULL);
+    for(size_t i = 0; i < names.size(); i++)
+    {
+        int width = 0;
+        int height = 0;
+        if(strlen(names[i]) >= (size_t)PACK_NAME_LENGTH || png_load(names[i], &width, &height, &pixels[i]) == 0)
+        {
+            fprintf(stderr, "Failed to read image texture from %s\n", names[i]);
+            return 1;
+        }
+        if(addSprite(atlas, width, height) == -1)
+        {
+            fprintf(stderr, "Image %s is too large for a %dx%d atlas page\n", names[i], ATLAS_PAGE_SIZE, ATLAS_PAGE_SIZE);
+            return 1;
+        }
+    }
+
+    packAtlas(atlas);
+    allocatePages(atlas);
+    for(size_t i = 0; i < names.size(); i++)
+    {
+        copySprite(atlas, i, pixels[i]);
+        free(pixels[i]);
+    }
+    if(premultiplied)
+    {
+        for(size_t p = 0; p < atlas.pages.size(); p++)
+            premultiply(atlas.pages[p]);
+    }
+
+    if(!writePack(output, atlas, names, premultiplied))
+    {
+        fprintf(stderr, "Failed to write sprite pack to %s\n", output);
+        return 1;
+    }
+    printf("Packed %d sprites into %d pages in %s%s\n", (int)names.size(), (int)atlas.pages.size(), output,
+           premultiplied ? " (pre-multiplied)" : "");
+    return 0;
+}
@@ -1,11 +1,13 @@
 /**
  * Header file responsible for binding, storing and drawing all textures.
+ * Every sprite is packed into a texture atlas (see atlas.h), so that a frame can be drawn with very few textures bound.
  */
 
 #ifndef PACMAN_TEXTURES_H
 #define PACMAN_TEXTURES_H
 
 /** Texture Storage **/
+// Each sprite is stored as its identifier within the atlas
 // Map Textures
 unsigned int map_tex;           // Map
 unsigned int pill_tex;          // Small Pill
@@ -52,9 +54,334 @@ unsigned int life_tex;          // Life counter
 unsigned int pause_tex;         // PAUSE screen
 unsigned int pause_alt_tex;     // PAUSE screen (alt)
 
+Atlas atlas;                        // Location of every sprite within the atlas pages
+vector<unsigned int> pageTextures;  // Texture of each atlas page
+vector<const char*> spriteFiles;    // PNG file of each registered sprite, loaded by loadSpritePack() or buildAtlas()
+
+const char* const SPRITE_PACK = "sprites.pack";     // Sprite pack built by spritepack, preferred over the PNG files
+
+// A sprite read from its PNG file, held until it is copied into the atlas
+struct DecodedSprite
+{
+    bool read;          // True once the file has been read
+    char* pixels;       // RGBA pixels, row by row from the bottom, or NULL if only the size has been read
+    int width;
+    int height;
+};
+
+/**
+ * Register a sprite to be loaded from a PNG file and added to the atlas by buildAtlas()
+ *
+ * @param filename - PNG file to load, which must be RGBA
+ * @return -         identifier of the sprite
+ */
+unsigned int registerSprite(const char* filename)
+{
+    spriteFiles.push_back(filename);
+    return spriteFiles.size() - 1;
+}
+
+/**
+ * Run a piece of work for every registered sprite, spreading the sprites across a pool of threads
+ * Each thread takes the next sprite not yet worked on until none remain - the work must not touch GL
+ *
+ * @param work - work to run, given the identifier of the sprite
+ * @return -     number of threads used
+ */
+int forEachSprite(function<void(size_t)> work)
+{
+    atomic<size_t> next(0);
+    int threads = max(min((int)thread::hardware_concurrency(), (int)spriteFiles.size()), 1);
+
+    vector<thread> workers;
+    for(int t = 0; t < threads; t++)
+    {
+        workers.push_back(thread([&work, &next]()
+        {
+            for(size_t i = next++; i < spriteFiles.size(); i = next++)
+                work(i);
+        }));
+    }
+    for(int t = 0; t < threads; t++)
+        workers[t].join();
+    return threads;
+}
+
+/**
+ * Create a texture holding an atlas page
+ *
+ * @param pixels - RGBA pixels of the page, row by row from the bottom
+ * @param size -   width and height of the page, in pixels
+ * @return -       texture of the page
+ */
+unsigned int bindPage(const void* pixels, int size)
+{
+    unsigned int texture = 0;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, size, size, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return texture;
+}
+
+/** Pixel Buffers **/
+// Pixel buffer objects, from the ARB_pixel_buffer_object extension, hold texture data in memory owned by GL, so that
+// sprites can be decoded straight into it and uploaded from it without copying. Like framebuffer objects (see below),
+// their functions are looked up at runtime.
+#ifndef GL_PIXEL_UNPACK_BUFFER_ARB
+#define GL_PIXEL_UNPACK_BUFFER_ARB      0x88EC
+#define GL_STREAM_DRAW_ARB              0x88E0
+#define GL_WRITE_ONLY_ARB               0x88B9
+#endif
+
+typedef void (APIENTRY *GenBuffersProc)(GLsizei n, GLuint* buffers);
+typedef void (APIENTRY *DeleteBuffersProc)(GLsizei n, const GLuint* buffers);
+typedef void (APIENTRY *BindBufferProc)(GLenum target, GLuint buffer);
+typedef void (APIENTRY *BufferDataProc)(GLenum target, ptrdiff_t size, const void* data, GLenum usage);
+typedef void* (APIENTRY *MapBufferProc)(GLenum target, GLenum access);
+typedef GLboolean (APIENTRY *UnmapBufferProc)(GLenum target);
+
+GenBuffersProc genBuffers = NULL;
+DeleteBuffersProc deleteBuffers = NULL;
+BindBufferProc bindBuffer = NULL;
+BufferDataProc bufferData = NULL;
+MapBufferProc mapBuffer = NULL;
+UnmapBufferProc unmapBuffer = NULL;
+
+/**
+ * Check whether the GL context supports an extension
+ *
+ * @param name - name of the extension
+ * @return -     true if the extension is supported
+ */
+bool hasExtension(const char* name)
+{
+    const char* extensions = (const char*)glGetString(GL_EXTENSIONS);
+    size_t length = strlen(name);
+    for(const char* found = extensions; found != NULL && (found = strstr(found, name)) != NULL; found += length)
+    {
+        if((found == extensions || found[-1] == ' ') && (found[length] == ' ' || found[length] == '\0'))
+            return true;
+    }
+    return false;
+}
+
+/**
+ * Look up the pixel buffer object functions, once a GL context exists
+ *
+ * @return - true if pixel buffer objects are supported and every function was found
+ */
+bool loadPixelBufferFunctions()
+{
+#ifdef __APPLE__
+    return false;   // GLUT on macOS has no glutGetProcAddress
+#else
+    if(!hasExtension("GL_ARB_pixel_buffer_object") || !hasExtension("GL_ARB_vertex_buffer_object"))
+        return false;
+
+    genBuffers = (GenBuffersProc)glutGetProcAddress("glGenBuffersARB");
+    deleteBuffers = (DeleteBuffersProc)glutGetProcAddress("glDeleteBuffersARB");
+    bindBuffer = (BindBufferProc)glutGetProcAddress("glBindBufferARB");
+    bufferData = (BufferDataProc)glutGetProcAddress("glBufferDataARB");
+    mapBuffer = (MapBufferProc)glutGetProcAddress("glMapBufferARB");
+    unmapBuffer = (UnmapBufferProc)glutGetProcAddress("glUnmapBufferARB");
+    return genBuffers != NULL && deleteBuffers != NULL && bindBuffer != NULL && bufferData != NULL &&
+           mapBuffer != NULL && unmapBuffer != NULL;
+#endif
+}
+
+/**
+ * Load every registered sprite from a sprite pack built by spritepack, uploading its pages straight from the file
+ * mapped into memory - nothing is decoded or copied. Pre-multiplied packs switch blending to match.
+ *
+ * @param filename - sprite pack to load
+ * @return -         false if the pack is missing, invalid or lacks any registered sprite, leaving nothing loaded
+ */
+bool loadSpritePack(const char* filename)
+{
+    steady_clock::time_point start = steady_clock::now();
+    Pack pack;
+    if(!openPack(filename, pack))
+        return false;
+
+    // Look up every registered sprite before uploading anything, so a stale pack is rejected whole
+    const PackHeader& header = *pack.header;
+    vector<AtlasSprite> sprites(spriteFiles.size());
+    for(size_t i = 0; i < spriteFiles.size(); i++)
+    {
+        const PackEntry* entry = findPackEntry(pack, spriteFiles[i]);
+        if(entry == NULL || entry->page < 0 || entry->page >= (int)header.pageCount || entry->x < 0 || entry->y < 0 ||
+           entry->x + entry->width > (int)header.pageSize || entry->y + entry->height > (int)header.pageSize)
+        {
+            closePack(pack);
+            return false;
+        }
+
+        AtlasSprite& sprite = sprites[i];
+        sprite.page = entry->page;
+        sprite.x = entry->x;
+        sprite.y = entry->y;
+        sprite.width = entry->width;
+        sprite.height = entry->height;
+        sprite.u0 = (float)sprite.x / header.pageSize;
+        sprite.v0 = (float)sprite.y / header.pageSize;
+        sprite.u1 = (float)(sprite.x + sprite.width) / header.pageSize;
+        sprite.v1 = (float)(sprite.y + sprite.height) / header.pageSize;
+    }
+
+    atlas.sprites = sprites;
+    for(uint32_t p = 0; p < header.pageCount; p++)
+        pageTextures.push_back(bindPage(packPage(pack, p), header.pageSize));
+    if(header.flags & PACK_PREMULTIPLIED)
+        glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    closePack(pack);
+
+    printf("Loaded %d sprites from %s in %.1f ms\n", (int)spriteFiles.size(), filename,
+           duration<double, milli>(steady_clock::now() - start).count());
+    return true;
+}
+
+/**
+ * Decode every packed sprite straight into pixel buffers mapped for each atlas page, then upload each page from its
+ * buffer. Each sprite's pixels are written just once, with no image buffers and no copies, and every page's upload is
+ * queued before any is waited on.
+ *
+ * @param decoded - sprites, whose sizes have been read
+ * @return -        false if the buffers could not be mapped, in which case nothing has been uploaded
+ */
+bool uploadDirect(vector<DecodedSprite>& decoded)
+{
+    size_t pageBytes = (size_t)ATLAS_PAGE_SIZE * ATLAS_PAGE_SIZE * 4;
+    vector<unsigned int> buffers(atlas.pageCount);
+    vector<char*> pages(atlas.pageCount, (char*)NULL);
+    genBuffers(atlas.pageCount, &buffers[0]);
+
+    bool mapped = true;
+    for(int p = 0; p < atlas.pageCount && mapped; p++)
+    {
+        bindBuffer(GL_PIXEL_UNPACK_BUFFER_ARB, buffers[p]);
+        bufferData(GL_PIXEL_UNPACK_BUFFER_ARB, pageBytes, NULL, GL_STREAM_DRAW_ARB);
+        pages[p] = (char*)mapBuffer(GL_PIXEL_UNPACK_BUFFER_ARB, GL_WRITE_ONLY_ARB);
+        mapped = pages[p] != NULL;
+    }
+    if(!mapped)
+    {
+        for(int p = 0; p < atlas.pageCount && pages[p] != NULL; p++)
+        {
+            bindBuffer(GL_PIXEL_UNPACK_BUFFER_ARB, buffers[p]);
+            unmapBuffer(GL_PIXEL_UNPACK_BUFFER_ARB);
+        }
+        bindBuffer(GL_PIXEL_UNPACK_BUFFER_ARB, 0);
+        deleteBuffers(atlas.pageCount, &buffers[0]);
+        return false;
+    }
+
+    // Clear each page's gutters and free space, then decode every sprite into place on the pool of threads
+    for(int p = 0; p < atlas.pageCount; p++)
+        memset(pages[p], 0, pageBytes);
+    forEachSprite([&decoded, &pages](size_t i)
+    {
+        const AtlasSprite& sprite = atlas.sprites[i];
+        char* corner = pages[sprite.page] + ((size_t)sprite.y * ATLAS_PAGE_SIZE + sprite.x) * 4;
+        decoded[i].read = png_load_into(spriteFiles[i], sprite.width, sprite.height, corner, ATLAS_PAGE_SIZE * 4) != 0;
+    });
+
+    for(int p = 0; p < atlas.pageCount; p++)
+    {
+        bindBuffer(GL_PIXEL_UNPACK_BUFFER_ARB, buffers[p]);
+        unmapBuffer(GL_PIXEL_UNPACK_BUFFER_ARB);
+        pageTextures.push_back(bindPage(NULL, ATLAS_PAGE_SIZE));    // NULL is an offset of 0 into the bound buffer
+    }
+    bindBuffer(GL_PIXEL_UNPACK_BUFFER_ARB, 0);
+    deleteBuffers(atlas.pageCount, &buffers[0]);    // Buffers are only released once their uploads are done
+    return true;
+}
+
 /**
- * Loads and binds all textures on game init, improving performance over binding every time the world is drawn.
- * Note: glTexImage2D was changed in load_and_bind_texture.h to support RGBA
+ * Load every registered sprite, pack them into atlas pages and bind each page as a texture
+ * This is the fallback for when no sprite pack has been built, such as during development.
+ * PNG files are read concurrently, leaving only the packing and the calls to GL on the calling (GL) thread. Where pixel
+ * buffers are supported, only the sizes of the sprites are read before packing, and they are then decoded straight
+ * into the pages (see uploadDirect()). Otherwise they are decoded up front, copied into pages in memory and uploaded,
+ * the pixels of both the sprites and the pages being freed once they have been handed to GL.
+ */
+void buildAtlas()
+{
+    steady_clock::time_point start = steady_clock::now();
+    bool direct = loadPixelBufferFunctions();
+    vector<DecodedSprite> decoded(spriteFiles.size(), DecodedSprite());
+    int threads = forEachSprite([&decoded, direct](size_t i)
+    {
+        DecodedSprite& sprite = decoded[i];
+        if(direct)
+            sprite.read = png_size(spriteFiles[i], &sprite.width, &sprite.height) != 0;
+        else
+            sprite.read = png_load(spriteFiles[i], &sprite.width, &sprite.height, &sprite.pixels) != 0;
+    });
+
+    for(size_t i = 0; i < decoded.size(); i++)
+    {
+        if(!decoded[i].read)
+        {
+            fprintf(stderr, "Failed to read image texture from %s\n", spriteFiles[i]);
+            exit(1);
+        }
+        if(addSprite(atlas, decoded[i].width, decoded[i].height) == -1)
+        {
+            fprintf(stderr, "Image %s is too large for a %dx%d atlas page\n", spriteFiles[i], ATLAS_PAGE_SIZE,
+                    ATLAS_PAGE_SIZE);
+            exit(1);
+        }
+    }
+    packAtlas(atlas);
+
+    if(direct && !uploadDirect(decoded))
+    {
+        // Pixel buffers failed to map, so decode the sprites up front after all
+        direct = false;
+        forEachSprite([&decoded](size_t i)
+        {
+            DecodedSprite& sprite = decoded[i];
+            int width, height;
+            sprite.read = png_load(spriteFiles[i], &width, &height, &sprite.pixels) != 0 && width == sprite.width &&
+                          height == sprite.height;
+        });
+    }
+    for(size_t i = 0; i < decoded.size(); i++)
+    {
+        if(!decoded[i].read)
+        {
+            fprintf(stderr, "Failed to read image texture from %s\n", spriteFiles[i]);
+            exit(1);
+        }
+    }
+
+    if(!direct)
+    {
+        allocatePages(atlas);
+        for(size_t i = 0; i < decoded.size(); i++)
+        {
+            copySprite(atlas, i, decoded[i].pixels);
+            free(decoded[i].pixels);
+        }
+        for(size_t i = 0; i < atlas.pages.size(); i++)
+            pageTextures.push_back(bindPage(&atlas.pages[i][0], ATLAS_PAGE_SIZE));
+        atlas.pages.clear();
+    }
+
+    // Report startup time spent on sprites
+    printf("Loaded %d sprites in %.1f ms (read on %d threads, uploaded %d pages %s)\n", (int)decoded.size(),
+           duration<double, milli>(steady_clock::now() - start).count(), threads, (int)pageTextures.size(),
+           direct ? "from pixel buffers" : "from memory");
+}
+
+/**
+ * Loads all sprites into the texture atlas on game init, improving performance over binding every time the world is drawn.
  */
 void loadBindTextures()
 {
@@ -63,85 +390,89 @@ void loadBindTextures()
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
     // Bind map textures
-    map_tex =           load_and_bind_texture("sprites/map/map.png");
-    pill_tex =          load_and_bind_texture("sprites/map/pill.png");
-    bigPill_tex[0] =    load_and_bind_texture("sprites/map/big-0.png");
-    bigPill_tex[1] =    load_and_bind_texture("sprites/map/big-1.png");
+    map_tex =           registerSprite("sprites/map/map.png");
+    pill_tex =          registerSprite("sprites/map/pill.png");
+    bigPill_tex[0] =    registerSprite("sprites/map/big-0.png");
+    bigPill_tex[1] =    registerSprite("sprites/map/big-1.png");
     // Bind Pac-Man textures
-    pac_0_tex =         load_and_bind_texture("sprites/pacman/0.png");
-    pac_1_tex =         load_and_bind_texture("sprites/pacman/1.png");
-    pac_2_tex =         load_and_bind_texture("sprites/pacman/2.png");
+    pac_0_tex =         registerSprite("sprites/pacman/0.png");
+    pac_1_tex =         registerSprite("sprites/pacman/1.png");
+    pac_2_tex =         registerSprite("sprites/pacman/2.png");
     // Bind Pac-Man Death textures
-    dead_tex[0] =       load_and_bind_texture("sprites/pacman/d-0.png");
-    dead_tex[1] =       load_and_bind_texture("sprites/pacman/d-1.png");
-    dead_tex[2] =       load_and_bind_texture("sprites/pacman/d-2.png");
-    dead_tex[3] =       load_and_bind_texture("sprites/pacman/d-3.png");
-    dead_tex[4] =       load_and_bind_texture("sprites/pacman/d-4.png");
-    dead_tex[5] =       load_and_bind_texture("sprites/pacman/d-5.png");
-    dead_tex[6] =       load_and_bind_texture("sprites/pacman/d-6.png");
-    dead_tex[7] =       load_and_bind_texture("sprites/pacman/d-7.png");
-    dead_tex[8] =       load_and_bind_texture("sprites/pacman/d-8.png");
-    dead_tex[9] =       load_and_bind_texture("sprites/pacman/d-9.png");
-    dead_tex[10] =      load_and_bind_texture("sprites/pacman/d-10.png");
+    dead_tex[0] =       registerSprite("sprites/pacman/d-0.png");
+    dead_tex[1] =       registerSprite("sprites/pacman/d-1.png");
+    dead_tex[2] =       registerSprite("sprites/pacman/d-2.png");
+    dead_tex[3] =       registerSprite("sprites/pacman/d-3.png");
+    dead_tex[4] =       registerSprite("sprites/pacman/d-4.png");
+    dead_tex[5] =       registerSprite("sprites/pacman/d-5.png");
+    dead_tex[6] =       registerSprite("sprites/pacman/d-6.png");
+    dead_tex[7] =       registerSprite("sprites/pacman/d-7.png");
+    dead_tex[8] =       registerSprite("sprites/pacman/d-8.png");
+    dead_tex[9] =       registerSprite("sprites/pacman/d-9.png");
+    dead_tex[10] =      registerSprite("sprites/pacman/d-10.png");
     // Bind ghost textures
-    ghost_r_tex[0] =    load_and_bind_texture("sprites/ghosts/r-0.png");
-    ghost_r_tex[1] =    load_and_bind_texture("sprites/ghosts/r-1.png");
-    ghost_p_tex[0] =    load_and_bind_texture("sprites/ghosts/p-0.png");
-    ghost_p_tex[1] =    load_and_bind_texture("sprites/ghosts/p-1.png");
-    ghost_b_tex[0] =    load_and_bind_texture("sprites/ghosts/b-0.png");
-    ghost_b_tex[1] =    load_and_bind_texture("sprites/ghosts/b-1.png");
-    ghost_y_tex[0] =    load_and_bind_texture("sprites/ghosts/y-0.png");
-    ghost_y_tex[1] =    load_and_bind_texture("sprites/ghosts/y-1.png");
-    ghost_f_tex[0] =    load_and_bind_texture("sprites/ghosts/f-0.png");
-    ghost_f_tex[1] =    load_and_bind_texture("sprites/ghosts/f-1.png");
-    ghost_f_tex[2] =    load_and_bind_texture("sprites/ghosts/f-2.png");
-    ghost_f_tex[3] =    load_and_bind_texture("sprites/ghosts/f-3.png");
+    ghost_r_tex[0] =    registerSprite("sprites/ghosts/r-0.png");
+    ghost_r_tex[1] =    registerSprite("sprites/ghosts/r-1.png");
+    ghost_p_tex[0] =    registerSprite("sprites/ghosts/p-0.png");
+    ghost_p_tex[1] =    registerSprite("sprites/ghosts/p-1.png");
+    ghost_b_tex[0] =    registerSprite("sprites/ghosts/b-0.png");
+    ghost_b_tex[1] =    registerSprite("sprites/ghosts/b-1.png");
+    ghost_y_tex[0] =    registerSprite("sprites/ghosts/y-0.png");
+    ghost_y_tex[1] =    registerSprite("sprites/ghosts/y-1.png");
+    ghost_f_tex[0] =    registerSprite("sprites/ghosts/f-0.png");
+    ghost_f_tex[1] =    registerSprite("sprites/ghosts/f-1.png");
+    ghost_f_tex[2] =    registerSprite("sprites/ghosts/f-2.png");
+    ghost_f_tex[3] =    registerSprite("sprites/ghosts/f-3.png");
     // Bind ghost eye textures
-    eye_u_tex =         load_and_bind_texture("sprites/eyes/u.png");
-    eye_r_tex =         load_and_bind_texture("sprites/eyes/r.png");
-    eye_d_tex =         load_and_bind_texture("sprites/eyes/d.png");
-    eye_l_tex =         load_and_bind_texture("sprites/eyes/l.png");
+    eye_u_tex =         registerSprite("sprites/eyes/u.png");
+    eye_r_tex =         registerSprite("sprites/eyes/r.png");
+    eye_d_tex =         registerSprite("sprites/eyes/d.png");
+    eye_l_tex =         registerSprite("sprites/eyes/l.png");
     // Bind fruit textures
-    fruits_tex[0] =     load_and_bind_texture("sprites/fruits/cherry.png");
-    fruits_tex[1] =     load_and_bind_texture("sprites/fruits/strawberry.png");
-    fruits_tex[2] =     load_and_bind_texture("sprites/fruits/orange.png");
-    fruits_tex[3] =     load_and_bind_texture("sprites/fruits/apple.png");
-    fruits_tex[4] =     load_and_bind_texture("sprites/fruits/melon.png");
-    fruits_tex[5] =     load_and_bind_texture("sprites/fruits/boss.png");
-    fruits_tex[6] =     load_and_bind_texture("sprites/fruits/bell.png");
-    fruits_tex[7] =     load_and_bind_texture("sprites/fruits/key.png");
-    f_score_tex[0] =    load_and_bind_texture("sprites/ui/100.png");
-    f_score_tex[1] =    load_and_bind_texture("sprites/ui/300.png");
-    f_score_tex[2] =    load_and_bind_texture("sprites/ui/500.png");
-    f_score_tex[3] =    load_and_bind_texture("sprites/ui/700.png");
-    f_score_tex[4] =    load_and_bind_texture("sprites/ui/1000.png");
-    f_score_tex[5] =    load_and_bind_texture("sprites/ui/2000.png");
-    f_score_tex[6] =    load_and_bind_texture("sprites/ui/3000.png");
-    f_score_tex[7] =    load_and_bind_texture("sprites/ui/5000.png");
+    fruits_tex[0] =     registerSprite("sprites/fruits/cherry.png");
+    fruits_tex[1] =     registerSprite("sprites/fruits/strawberry.png");
+    fruits_tex[2] =     registerSprite("sprites/fruits/orange.png");
+    fruits_tex[3] =     registerSprite("sprites/fruits/apple.png");
+    fruits_tex[4] =     registerSprite("sprites/fruits/melon.png");
+    fruits_tex[5] =     registerSprite("sprites/fruits/boss.png");
+    fruits_tex[6] =     registerSprite("sprites/fruits/bell.png");
+    fruits_tex[7] =     registerSprite("sprites/fruits/key.png");
+    f_score_tex[0] =    registerSprite("sprites/ui/100.png");
+    f_score_tex[1] =    registerSprite("sprites/ui/300.png");
+    f_score_tex[2] =    registerSprite("sprites/ui/500.png");
+    f_score_tex[3] =    registerSprite("sprites/ui/700.png");
+    f_score_tex[4] =    registerSprite("sprites/ui/1000.png");
+    f_score_tex[5] =    registerSprite("sprites/ui/2000.png");
+    f_score_tex[6] =    registerSprite("sprites/ui/3000.png");
+    f_score_tex[7] =    registerSprite("sprites/ui/5000.png");
     // Bind UI textures
-    num_0_tex =         load_and_bind_texture("sprites/ui/0.png");
-    num_1_tex =         load_and_bind_texture("sprites/ui/1.png");
-    num_2_tex =         load_and_bind_texture("sprites/ui/2.png");
-    num_3_tex =         load_and_bind_texture("sprites/ui/3.png");
-    num_4_tex =         load_and_bind_texture("sprites/ui/4.png");
-    num_5_tex =         load_and_bind_texture("sprites/ui/5.png");
-    num_6_tex =         load_and_bind_texture("sprites/ui/6.png");
-    num_7_tex =         load_and_bind_texture("sprites/ui/7.png");
-    num_8_tex =         load_and_bind_texture("sprites/ui/8.png");
-    num_9_tex =         load_and_bind_texture("sprites/ui/9.png");
-    g_scores_tex[0] =   load_and_bind_texture("sprites/ui/200.png");
-    g_scores_tex[1] =   load_and_bind_texture("sprites/ui/400.png");
-    g_scores_tex[2] =   load_and_bind_texture("sprites/ui/800.png");
-    g_scores_tex[3] =   load_and_bind_texture("sprites/ui/1600.png");
-    one_up_tex =        load_and_bind_texture("sprites/ui/1up.png");
-    score_tex =         load_and_bind_texture("sprites/ui/score.png");
-    ready_tex =         load_and_bind_texture("sprites/ui/ready.png");
-    gameover_tex =      load_and_bind_texture("sprites/ui/gameover.png");
-    help_tex =          load_and_bind_texture("sprites/ui/help.png");
-    quit_tex =          load_and_bind_texture("sprites/ui/quit.png");
-    life_tex =          load_and_bind_texture("sprites/ui/life.png");
-    pause_tex =         load_and_bind_texture("sprites/ui/pause.png");
-    pause_alt_tex =     load_and_bind_texture("sprites/ui/pause_alt.png");
+    num_0_tex =         registerSprite("sprites/ui/0.png");
+    num_1_tex =         registerSprite("sprites/ui/1.png");
+    num_2_tex =         registerSprite("sprites/ui/2.png");
+    num_3_tex =         registerSprite("sprites/ui/3.png");
+    num_4_tex =         registerSprite("sprites/ui/4.png");
+    num_5_tex =         registerSprite("sprites/ui/5.png");
+    num_6_tex =         registerSprite("sprites/ui/6.png");
+    num_7_tex =         registerSprite("sprites/ui/7.png");
+    num_8_tex =         registerSprite("sprites/ui/8.png");
+    num_9_tex =         registerSprite("sprites/ui/9.png");
+    g_scores_tex[0] =   registerSprite("sprites/ui/200.png");
+    g_scores_tex[1] =   registerSprite("sprites/ui/400.png");
+    g_scores_tex[2] =   registerSprite("sprites/ui/800.png");
+    g_scores_tex[3] =   registerSprite("sprites/ui/1600.png");
+    one_up_tex =        registerSprite("sprites/ui/1up.png");
+    score_tex =         registerSprite("sprites/ui/score.png");
+    ready_tex =         registerSprite("sprites/ui/ready.png");
+    gameover_tex =      registerSprite("sprites/ui/gameover.png");
+    help_tex =          registerSprite("sprites/ui/help.png");
+    quit_tex =          registerSprite("sprites/ui/quit.png");
+    life_tex =          registerSprite("sprites/ui/life.png");
+    pause_tex =         registerSprite("sprites/ui/pause.png");
+    pause_alt_tex =     registerSprite("sprites/ui/pause_alt.png");
+
+    // Load every sprite from the pre-built pack if possible, otherwise decode and pack them here
+    if(!loadSpritePack(SPRITE_PACK))
+        buildAtlas();
 }
 
 /**
@@ -156,47 +487,173 @@ void rgb(float r, float g, float b)
     glColor3f(r/255,g/255,b/255);
 }
 
+/** Sprite Batching **/
+// Sprites are not drawn as soon as they are requested. Each is instead appended as a quad to a batch held in client
+// memory, which is drawn with a single glDrawArrays call when the atlas page changes, when it is full, or when the frame
+// ends. Translations are tracked on the CPU in place of the GL modelview matrix, so that queued quads need no state.
+const int MAX_TRANSLATIONS = 8;     // Deepest nesting of pushTranslation() calls
+const int BATCH_QUADS = 512;        // Quads held before the batch must be flushed
+
+float translations[MAX_TRANSLATIONS][2];    // Stack of (x,y) translations, the top applying to sprites being drawn
+int translationDepth = 0;                   // Index of the top of the translation stack
+
+float batchVertices[BATCH_QUADS * 8];       // (x,y) of each corner of every queued quad
+float batchTexCoords[BATCH_QUADS * 8];      // (u,v) of each corner of every queued quad
+int batchQuads = 0;                         // Number of quads queued
+int batchPage = 0;                          // Atlas page shared by every queued quad
+
+/**
+ * Save the current translation, to be restored by popTranslation()
+ */
+void pushTranslation()
+{
+    translations[translationDepth + 1][0] = translations[translationDepth][0];
+    translations[translationDepth + 1][1] = translations[translationDepth][1];
+    translationDepth++;
+}
+
+/**
+ * Restore the translation saved by the last pushTranslation()
+ */
+void popTranslation()
+{
+    translationDepth--;
+}
+
+/**
+ * Translate the position of drawing by a given (x,y) in window coordinates
+ *
+ * @param x - distance to translate along the x axis
+ * @param y - distance to translate along the y axis
+ */
+void translate(float x, float y)
+{
+    translations[translationDepth][0] += x;
+    translations[translationDepth][1] += y;
+}
+
 /**
- * Draws a given texture as a sprite of given length and height, applying a rotation of the given angle
+ * Draw every queued quad in one call, then empty the batch
+ */
+void flushSprites()
+{
+    if(batchQuads == 0)
+        return;
+
+    glEnable(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, pageTextures[batchPage]);
+    PROFILE_COUNT(COUNTER_BINDS);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+    glVertexPointer(2, GL_FLOAT, 0, batchVertices);
+    glTexCoordPointer(2, GL_FLOAT, 0, batchTexCoords);
+
+    glDrawArrays(GL_QUADS, 0, batchQuads * 4);
+    PROFILE_COUNT(COUNTER_DRAWS);
+
+    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    glDisable(GL_TEXTURE_2D);
+    batchQuads = 0;
+}
+
+/**
+ * Prepare to draw a new frame of sprites, starting from the window's bottom left corner
+ */
+void beginSprites()
+{
+    translationDepth = 0;
+    translations[0][0] = 0;
+    translations[0][1] = 0;
+    rgb(255,255,255);   // Reset drawing colour to white, preventing texture discolouration
+}
+
+/**
+ * Queue a given sprite to be drawn with given length and height, applying a rotation of the given angle
+ * The sprite is drawn at the current translation by the next flushSprites()
  *
- * @param texture - unsigned int corresponding to the loaded and bound texture
+ * @param sprite -  identifier of the sprite, as returned by registerSprite()
  * @param length -  integer length of the sprite to be drawn
  * @param height -  integer height of the sprite to be drawn
  * @param angle -   rotate the drawn sprite by a given angle (float)
  */
-void drawSprite(unsigned int texture, int length, int height, float angle)
+void drawSprite(unsigned int sprite, int length, int height, float angle)
 {
-    // Begin new transformation matrix
-    glPushMatrix();
-    rgb(255,255,255);   // Reset drawing colour to white, preventing texture discolouration
+    PROFILE_COUNT(COUNTER_SPRITES);
+    const AtlasSprite& rect = atlas.sprites[sprite];
+    if(rect.page != batchPage || batchQuads == BATCH_QUADS)
+    {
+        flushSprites();
+        batchPage = rect.page;
+    }
 
     int halfLength = length/2;
     int halfHeight = height/2;
 
-    // Translate to center of sprite and rotate if necessary
-    glTranslatef((float)halfLength,(float)halfHeight,0.0f);
-    glRotatef(angle, 0.0f, 0.0f, 1.0f);
+    // Center of sprite, about which it is rotated
+    float centerX = translations[translationDepth][0] + halfLength;
+    float centerY = translations[translationDepth][1] + halfHeight;
+    float radians = angle * (float)M_PI / 180.0f;
+    float c = cosf(radians);
+    float s = sinf(radians);
 
-    // Enable texturing and bind selected sprite
-    glEnable(GL_TEXTURE_2D);
-    glBindTexture(GL_TEXTURE_2D, texture);
+    // Corners of the sprite, bottom left, bottom right, top right and top left, before rotation
+    const float corners[8] = {(float)-halfLength, (float)-halfHeight, (float)halfLength, (float)-halfHeight,
+                              (float)halfLength, (float)halfHeight, (float)-halfLength, (float)halfHeight};
+    const float texCoords[8] = {rect.u0, rect.v0, rect.u1, rect.v0, rect.u1, rect.v1, rect.u0, rect.v1};
 
-    // Draw sprite shape as square to be textured of size (length,height)
-    glBegin(GL_QUADS);
-        glTexCoord2f (0.0f, 0.0f);      // Bottom left
-        glVertex2i(-halfLength, -halfHeight);
-        glTexCoord2f (1.0f, 0.0f);      // Bottom right
-        glVertex2i(halfLength, -halfHeight);
-        glTexCoord2f (1.0f, 1.0f);      // Top right
-        glVertex2i(halfLength, halfHeight);
-        glTexCoord2f (0.0f, 1.0f);      // Top left
-        glVertex2i(-halfLength, halfHeight);
-    glEnd();
+    float* vertex = &batchVertices[batchQuads * 8];
+    float* texCoord = &batchTexCoords[batchQuads * 8];
+    for(int i = 0; i < 8; i += 2)
+    {
+        vertex[i] = centerX + c * corners[i] - s * corners[i + 1];
+        vertex[i + 1] = centerY + s * corners[i] + c * corners[i + 1];
+        texCoord[i] = texCoords[i];
+        texCoord[i + 1] = texCoords[i + 1];
+    }
+    batchQuads++;
+}
 
-    glDisable(GL_TEXTURE_2D);
+/** Offscreen Rendering **/
+// Framebuffer objects, used to render into textures, come from the EXT_framebuffer_object extension. Its functions are
+// looked up at runtime, as opengl32 on Windows only exports GL 1.1 - where the extension is missing, everything is
+// drawn straight to the window instead.
+#ifndef GL_FRAMEBUFFER_EXT
+#define GL_FRAMEBUFFER_EXT              0x8D40
+#define GL_COLOR_ATTACHMENT0_EXT        0x8CE0
+#define GL_FRAMEBUFFER_COMPLETE_EXT     0x8CD5
+#endif
+
+typedef void (APIENTRY *GenFramebuffersProc)(GLsizei n, GLuint* framebuffers);
+typedef void (APIENTRY *BindFramebufferProc)(GLenum target, GLuint framebuffer);
+typedef void (APIENTRY *FramebufferTexture2DProc)(GLenum target, GLenum attachment, GLenum textarget, GLuint texture, GLint level);
+typedef GLenum (APIENTRY *CheckFramebufferStatusProc)(GLenum target);
+
+GenFramebuffersProc genFramebuffers = NULL;
+BindFramebufferProc bindFramebuffer = NULL;
+FramebufferTexture2DProc framebufferTexture2D = NULL;
+CheckFramebufferStatusProc checkFramebufferStatus = NULL;
+
+/**
+ * Look up the framebuffer object functions, once a GL context exists
+ *
+ * @return - true if framebuffer objects are supported and every function was found
+ */
+bool loadFramebufferFunctions()
+{
+#ifdef __APPLE__
+    return false;   // GLUT on macOS has no glutGetProcAddress
+#else
+    if(!hasExtension("GL_EXT_framebuffer_object"))
+        return false;
 
-    // Pop matrix to ignore above transformations on future objects
-    glPopMatrix();
+    genFramebuffers = (GenFramebuffersProc)glutGetProcAddress("glGenFramebuffersEXT");
+    bindFramebuffer = (BindFramebufferProc)glutGetProcAddress("glBindFramebufferEXT");
+    framebufferTexture2D = (FramebufferTexture2DProc)glutGetProcAddress("glFramebufferTexture2DEXT");
+    checkFramebufferStatus = (CheckFramebufferStatusProc)glutGetProcAddress("glCheckFramebufferStatusEXT");
+    return genFramebuffers != NULL && bindFramebuffer != NULL && framebufferTexture2D != NULL &&
+           checkFramebufferStatus != NULL;
+#endif
 }
 
 #endif //PACMAN_TEXTURES_H
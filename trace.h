@@ -0,0 +1,177 @@
+/**
+ * Header file responsible for tracing the game, recording scoped spans and instant events as they happen for export
+ * as Chrome trace event JSON, which can be opened in Perfetto (ui.perfetto.dev) or chrome://tracing.
+ *
+ * Spans are recorded by placing TRACE_SPAN(name) at the start of the scope to be traced, and instant events by
+ * TRACE_EVENT(name) or TRACE_EVENT_VALUE(name, value). Names must be string literals (or otherwise outlive the trace),
+ * as only the pointer is recorded. Every thread records into a ring buffer of its own, so recording takes no lock -
+ * once a buffer is full its oldest events are overwritten. Timestamps are read from the CPU's time stamp counter where
+ * available, and converted to microseconds only as the trace is written.
+ *
+ * Nothing is recorded by a thread while it is not instrumented (see profile.h), as while searching copies of the game.
+ *
+ * Everything here compiles to nothing unless PACMAN_TRACE is defined, set through the TRACE make flag.
+ */
+
+#ifndef PACMAN_TRACE_H
+#define PACMAN_TRACE_H
+
+#ifdef PACMAN_TRACE
+const char* const TRACE_FILE = "trace.json";    // File the windowed game writes its trace to as it exits
+const int TRACE_EVENTS = 1 << 16;               // Events held by each thread's ring buffer, a power of two
+const uint64_t TRACE_INSTANT = UINT64_MAX;      // Duration recorded for instant events
+
+// Names of the game modes and ghost AI movement types, for events recording changes to them
+const char* const TRACE_MODE_NAMES[] = {"READY", "PLAY", "FRUIT", "EAT", "PAUSE", "DEATH", "GAMEOVER"};
+const char* const TRACE_AI_NAMES[] = {"CHASE", "SCATTER", "FRIGHTENED", "DEAD", "LEAVE", "SPAWN"};
+
+struct TraceEvent
+{
+    const char* name;
+    uint64_t start;         // Clock reading at the start of the span, or at the event
+    uint64_t duration;      // Clock ticks spanned, or TRACE_INSTANT
+    int value;              // Value recorded with an instant event, or -1 if none
+};
+
+// Ring buffer of the events recorded by a single thread
+struct TraceBuffer
+{
+    int thread;                         // Index of the thread, in order of its first event
+    uint64_t count;                     // Events recorded, wrapping around the buffer
+    TraceEvent events[TRACE_EVENTS];
+};
+
+vector<TraceBuffer*> traceBuffers;              // Buffer of every thread that has recorded an event
+mutex traceLock;                                // Guards traceBuffers as threads start recording
+thread_local TraceBuffer* traceBuffer = NULL;   // Buffer of the current thread, once it has recorded an event
+
+/**
+ * Read the trace clock - the time stamp counter on x86, which is far cheaper to read than the system clock
+ *
+ * @return - current clock reading
+ */
+inline uint64_t traceClock()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+// Readings of the trace clock and the system clock at startup, from which trace clock readings are converted to time
+const uint64_t traceStartClock = traceClock();
+const steady_clock::time_point traceStartTime = steady_clock::now();
+
+/**
+ * Get the current thread's buffer, creating it on the thread's first event
+ *
+ * @return - buffer of the current thread
+ */
+inline TraceBuffer* traceThread()
+{
+    if(traceBuffer == NULL)
+    {
+        lock_guard<mutex> guard(traceLock);
+        traceBuffer = new TraceBuffer();
+        traceBuffer->thread = traceBuffers.size();
+        traceBuffers.push_back(traceBuffer);
+    }
+    return traceBuffer;
+}
+
+/**
+ * Record an event into the current thread's buffer
+ *
+ * @param name -     name of the event
+ * @param start -    clock reading at the start of the event
+ * @param duration - clock ticks spanned, or TRACE_INSTANT
+ * @param value -    value recorded with the event, or -1 if none
+ */
+inline void traceRecord(const char* name, uint64_t start, uint64_t duration, int value)
+{
+    if(!instrumented)
+        return;
+    TraceBuffer* buffer = traceThread();
+    TraceEvent& event = buffer->events[buffer->count++ & (TRACE_EVENTS - 1)];
+    event.name = name;
+    event.start = start;
+    event.duration = duration;
+    event.value = value;
+}
+
+// Records the scope it is declared in as a span
+class TraceSpan
+{
+private:
+    const char* name;
+    uint64_t start;
+
+public:
+    TraceSpan(const char* n) : name(n), start(traceClock()) {}
+    ~TraceSpan()
+    {
+        traceRecord(name, start, traceClock() - start, -1);
+    }
+};
+
+#define TRACE_JOIN(a, b) a##b
+#define TRACE_NAME(line) TRACE_JOIN(traceSpan, line)
+#define TRACE_SPAN(name) TraceSpan TRACE_NAME(__LINE__)(name)
+#define TRACE_EVENT(name) traceRecord(name, traceClock(), TRACE_INSTANT, -1)
+#define TRACE_EVENT_VALUE(name, value) traceRecord(name, traceClock(), TRACE_INSTANT, value)
+
+/**
+ * Write every event held in the threads' buffers to a file as Chrome trace event JSON
+ * Must only be called while no other thread is recording events - once worker threads have been joined
+ *
+ * @param filename - file to write
+ * @return -         true if the whole trace was written
+ */
+bool writeTrace(const char* filename)
+{
+    // Microseconds per tick of the trace clock, measured over the whole run
+    uint64_t clockTicks = traceClock() - traceStartClock;
+    double micros = duration<double, micro>(steady_clock::now() - traceStartTime).count();
+    double scale = clockTicks > 0 ? micros / clockTicks : 0;
+
+    FILE* file = fopen(filename, "w");
+    if(file == NULL)
+        return false;
+    fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    bool first = true;
+    lock_guard<mutex> guard(traceLock);
+    for(size_t b = 0; b < traceBuffers.size(); b++)
+    {
+        const TraceBuffer& buffer = *traceBuffers[b];
+        fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"thread %d\"}}",
+                first ? "" : ",\n", buffer.thread, buffer.thread);
+        first = false;
+
+        // Once the buffer has wrapped, only the latest TRACE_EVENTS events remain
+        uint64_t oldest = buffer.count > (uint64_t)TRACE_EVENTS ? buffer.count - TRACE_EVENTS : 0;
+        for(uint64_t i = oldest; i < buffer.count; i++)
+        {
+            const TraceEvent& event = buffer.events[i & (TRACE_EVENTS - 1)];
+            double timestamp = (double)(int64_t)(event.start - traceStartClock) * scale;
+            if(event.duration == TRACE_INSTANT)
+                fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":%d,\"ts\":%.3f", event.name,
+                        buffer.thread, timestamp);
+            else
+                fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f",
+                        event.name, buffer.thread, timestamp, event.duration * scale);
+            if(event.value != -1)
+                fprintf(file, ",\"args\":{\"value\":%d}", event.value);
+            fprintf(file, "}");
+        }
+    }
+    fprintf(file, "\n]}\n");
+    return fclose(file) == 0;
+}
+#else
+#define TRACE_SPAN(name) ((void)0)
+#define TRACE_EVENT(name) ((void)0)
+#define TRACE_EVENT_VALUE(name, value) ((void)0)
+#endif //PACMAN_TRACE
+
+#endif //PACMAN_TRACE_H
@@ -45,4 +45,40 @@ typedef enum {CHASE, SCATTER, FRIGHTENED, DEAD, LEAVE, SPAWN} movement;
  */
 typedef enum {READY, PLAY, FRUIT, EAT, PAUSE, DEATH, GAMEOVER} gamemode;
 
+// A point (tile) in map coordinates - a plain pair of integers, cheap to copy and never heap allocated
+struct Point
+{
+    int x;
+    int y;
+};
+
+/**
+ * Positions and speeds of Pac-Man & Ghosts are fixed-point integers, measured in sub-tile units
+ * SUB_TILE units make up one tile, so that every speed used (4%, 5%, 10% and 20% of a tile per tick) is a whole
+ * number of units - movement is exact, and a tile center is any position divisible by SUB_TILE
+ */
+const int SUB_TILE = 100;
+
+/**
+ * Convert a position in sub-tile units to the nearest tile coordinate, rounding halves away from zero
+ *
+ * @param pos - position in sub-tile units
+ * @return -    nearest tile coordinate
+ */
+inline int toTile(int pos)
+{
+    return pos >= 0 ? (pos + SUB_TILE / 2) / SUB_TILE : -((SUB_TILE / 2 - pos) / SUB_TILE);
+}
+
+/**
+ * Snap a position in sub-tile units to the center of the nearest tile
+ *
+ * @param pos - position in sub-tile units
+ * @return -    position of the nearest tile center, in sub-tile units
+ */
+inline int snapToTile(int pos)
+{
+    return toTile(pos) * SUB_TILE;
+}
+
 #endif //PACMAN_TYPES_H
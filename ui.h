@@ -5,12 +5,6 @@
 #ifndef PACMAN_UI_H
 #define PACMAN_UI_H
 
-// Allow access of score, level, lives and fruits consumed from globals.h
-extern int score;
-extern int level;
-extern int lives;
-extern int fruits;
-
 // Initialise high score as integer to be set on init()
 int highscore;
 
@@ -19,13 +13,13 @@ int highscore;
  */
 void drawReady()
 {
-    glPushMatrix();
+    pushTranslation();
 
     translateMapOrigin();               // Translate to map origin
     translateMapCoords(11,13);          // Translate to point within map at which READY! tooltip should be drawn
     drawSprite(ready_tex, 48, 8, 0);    // Draw READY! sprite at current location
 
-    glPopMatrix();
+    popTranslation();
 }
 
 /**
@@ -33,13 +27,13 @@ void drawReady()
  */
 void drawGameover()
 {
-    glPushMatrix();
+    pushTranslation();
 
     translateMapOrigin();               // Translate to map origin
     translateMapCoords(9,13);           // Translate to point within map at which GAME OVER tooltip should be drawn
     drawSprite(gameover_tex, 80, 8, 0); // Draw GAME OVER sprite at current location
 
-    glPopMatrix();
+    popTranslation();
 }
 
 /**
@@ -49,7 +43,7 @@ void drawGameover()
  */
 void drawNumberAsSprite(int number)
 {
-    glPushMatrix();
+    pushTranslation();
 
     string str = to_string(number);   // Convert number to string to allow iteration
     for(int i = str.length() - 1; i >= 0; i--)  // Draw each digit as an individual sprite
@@ -93,16 +87,18 @@ void drawNumberAsSprite(int number)
     if(str.length() == 1)
         drawSprite(num_0_tex, 8, 8, 0);
 
-    glPopMatrix();
+    popTranslation();
 }
 
 /**
  * Draw game score and any previously attained high score
  * Note: maximum drawable score is 99,999 to prevent overflowing atop other parts of the UI
+ *
+ * @param score - current game score
  */
-void drawScore()
+void drawScore(int score)
 {
-    glPushMatrix();
+    pushTranslation();
 
     translateMapOrigin();               // Translate to map origin
     translateMapCoords(6.5,32.5);       // Translate to point above map at which the score tooltip should be drawn
@@ -114,15 +110,17 @@ void drawScore()
     translateMapCoords(6,0);            // Translate to point above map at which the score should be drawn
     drawNumberAsSprite(min(score,99999));   // Draw score sprites at current location
 
-    glPopMatrix();
+    popTranslation();
 }
 
 /**
  * Draw game level
+ *
+ * @param level - current game level
  */
-void drawLevel()
+void drawLevel(int level)
 {
-    glPushMatrix();
+    pushTranslation();
 
     translateMapOrigin();               // Translate to map origin
     translateMapCoords(1,32.5);         // Translate to point above map at which the 1UP tooltip should be drawn
@@ -131,15 +129,17 @@ void drawLevel()
     translateMapCoords(3,-1);           // Translate to point above map at which the level should be drawn
     drawNumberAsSprite(level);          // Draw level sprites at new location
 
-    glPopMatrix();
+    popTranslation();
 }
 
 /**
  * Draw lives count, displayed beneath the map
+ *
+ * @param lives - remaining lives
  */
-void drawLives()
+void drawLives(int lives)
 {
-    glPushMatrix();
+    pushTranslation();
 
     translateMapOrigin();                   // Translate to map origin
     translateMapCoords(1,-2.5);             // Translate to point beneath map, from which lives should be drawn
@@ -149,7 +149,7 @@ void drawLives()
         translateMapCoords(2,0);            // Translate to right where next life counter sprite should be drawn
     }
 
-    glPopMatrix();
+    popTranslation();
 }
 
 /**
@@ -157,13 +157,13 @@ void drawLives()
  */
 void drawHelp()
 {
-    glPushMatrix();
+    pushTranslation();
 
     translateMapOrigin();               // Translate to map origin
     translateMapCoords(19,32);          // Translate to point above map at which the HELP tooltip should be drawn
     drawSprite(help_tex, 64, 8, 0);     // Draw HELP tooltip at current location
 
-    glPopMatrix();
+    popTranslation();
 }
 
 /**
@@ -171,7 +171,7 @@ void drawHelp()
  */
 void drawPause(bool gameover)
 {
-    glPushMatrix();
+    pushTranslation();
 
     translateMapOrigin();                       // Translate to map origin
     if(!gameover)
@@ -179,7 +179,7 @@ void drawPause(bool gameover)
     else
         drawSprite(pause_alt_tex, 224, 248, 0); // Draw alternate PAUSE screen as a sprite (restart text only when mode=GAMEOVER)
 
-    glPopMatrix();
+    popTranslation();
 }
 
 /**
@@ -187,13 +187,13 @@ void drawPause(bool gameover)
  */
 void drawQuit()
 {
-    glPushMatrix();
+    pushTranslation();
 
     translateMapOrigin();               // Translate to map origin
     translateMapCoords(19,32);          // Translate to point above map at which the QUIT tooltip should be drawn
     drawSprite(quit_tex, 64, 8, 0);     // Draw QUIT tooltip at current location
 
-    glPopMatrix();
+    popTranslation();
 }
 
 /**
@@ -227,10 +227,12 @@ void setHighscore()
 
 /**
  * Draw the fruits Pac-Man has already eaten, displayed beneath the map
+ *
+ * @param fruits - number of fruits consumed
  */
-void drawFruits()
+void drawFruits(int fruits)
 {
-    glPushMatrix();
+    pushTranslation();
 
     translateMapOrigin();                       // Translate to map origin
     translateMapCoords(25,-2.5);                // Translate to point beneath map, from which lives should be drawn
@@ -240,7 +242,151 @@ void drawFruits()
         translateMapCoords(-2,0);               // Translate to right where next life counter sprite should be drawn
     }
 
-    glPopMatrix();
+    popTranslation();
+}
+
+/**
+ * Draw the rewind bar over the frame while scrubbing through the history: how far behind the latest state the state
+ * shown is, and its place within the history held
+ * Drawn in immediate mode after all sprites have been flushed
+ *
+ * @param behind -   seconds of play between the state shown and the latest state
+ * @param fraction - place of the state shown within the history, from 0 (oldest) to 1 (latest)
+ */
+void drawRewind(float behind, float fraction)
+{
+    const float left = 20.0f, right = 280.0f, bottom = 140.0f, top = 160.0f;
+
+    // Darken the area behind the bar, leaving the game visible through it
+    glColor4f(0.0f, 0.0f, 0.0f, 0.75f);
+    glRectf(left, bottom, right, top);
+
+    char text[32];
+    snprintf(text, sizeof(text), "REWIND  -%.1fs", behind);
+    rgb(255,255,255);
+    glRasterPos2f(left + 4, top - 8);
+    for(const char* c = text; *c != '\0'; c++)
+        glutBitmapCharacter(GLUT_BITMAP_8_BY_13, *c);
+
+    // Track of the whole history, filled up to the state shown
+    rgb(80,80,80);
+    glRectf(left + 4, bottom + 3, right - 4, bottom + 6);
+    rgb(255,255,0);
+    glRectf(left + 4, bottom + 3, left + 4 + fraction * (right - left - 8), bottom + 6);
+
+    rgb(255,255,255);   // Reset drawing colour to white, preventing texture discolouration
+}
+
+#ifdef PACMAN_PROFILE
+const float HUD_LEFT = 2.0f;            // Left edge of the profiling HUD, in window coordinates
+const float HUD_TOP = 298.0f;           // Top edge of the profiling HUD
+const float HUD_WIDTH = 150.0f;         // Width of the profiling HUD
+const float HUD_LINE = 7.0f;            // Height of a line of text, set in 8x13 pixel characters at 2 pixels per unit
+const int HUD_BUCKETS = 36;             // Millisecond buckets of the frame time histogram, the last holding all slower
+const float HUD_BUCKET_WIDTH = 4.0f;    // Width of each bucket's bar
+const float HUD_GRAPH_HEIGHT = 24.0f;   // Height of the tallest bar of the histogram
+
+/**
+ * Draw a line of text on the profiling HUD
+ *
+ * @param line - line of the HUD, counting down from the top
+ * @param text - text to draw, in the current colour
+ */
+void drawProfileText(int line, const char* text)
+{
+    glRasterPos2f(HUD_LEFT + 2, HUD_TOP - (line + 1) * HUD_LINE + 1.5f);
+    for(const char* c = text; *c != '\0'; c++)
+        glutBitmapCharacter(GLUT_BITMAP_8_BY_13, *c);
+}
+
+/**
+ * Draw the profiling HUD over the frame, if shown: the 50th and 99th percentile time taken by each phase, between
+ * frames, by the slowest tick of each frame and from input to its presentation, the work done drawing the last frame,
+ * a warning when ticks have run over budget, and a histogram of the time between frames
+ * Drawn in immediate mode after all sprites have been flushed, and not itself timed or counted
+ */
+void drawProfile()
+{
+    if(!profile.visible)
+        return;
+
+    int frames = profileFrames();
+    int lines = PHASE_COUNT + 6;
+    float bottom = HUD_TOP - lines * HUD_LINE - HUD_GRAPH_HEIGHT - 4;
+
+    // Darken the area behind the HUD, leaving the game visible through it
+    glColor4f(0.0f, 0.0f, 0.0f, 0.75f);
+    glRectf(HUD_LEFT, bottom, HUD_LEFT + HUD_WIDTH, HUD_TOP);
+
+    char text[64];
+    rgb(255,255,255);
+    drawProfileText(0, "phase          p50 ms   p99 ms");
+    for(int p = 0; p < PHASE_COUNT; p++)
+    {
+        snprintf(text, sizeof(text), "%-12s %8.3f %8.3f", PHASE_NAMES[p],
+                 profilePercentile(profile.phaseHistory[p], frames, 50), profilePercentile(profile.phaseHistory[p], frames, 99));
+        drawProfileText(p + 1, text);
+    }
+    snprintf(text, sizeof(text), "%-12s %8.3f %8.3f", "frame", profilePercentile(profile.frameHistory, frames, 50),
+             profilePercentile(profile.frameHistory, frames, 99));
+    drawProfileText(PHASE_COUNT + 1, text);
+    snprintf(text, sizeof(text), "%-12s %8.3f %8.3f", "slowest tick", profilePercentile(profile.tickHistory, frames, 50),
+             profilePercentile(profile.tickHistory, frames, 99));
+    drawProfileText(PHASE_COUNT + 2, text);
+    int inputs = min(inputLatency.count, LATENCY_SAMPLES);     // Inputs held by the samples, which wrap around
+    snprintf(text, sizeof(text), "%-12s %8.3f %8.3f", "input lag", profilePercentile(inputLatency.samples, inputs, 50),
+             profilePercentile(inputLatency.samples, inputs, 99));
+    drawProfileText(PHASE_COUNT + 3, text);
+    snprintf(text, sizeof(text), "sprites %lld  binds %lld  draws %lld", profile.lastCounters[COUNTER_SPRITES],
+             profile.lastCounters[COUNTER_BINDS], profile.lastCounters[COUNTER_DRAWS]);
+    drawProfileText(PHASE_COUNT + 4, text);
+
+    int over = ticksOverBudget();
+    if(over > 0)
+    {
+        rgb(255,0,0);
+        snprintf(text, sizeof(text), "%d ticks over %.0f ms budget", over, TICK_BUDGET_MS);
+        drawProfileText(PHASE_COUNT + 5, text);
+    }
+
+    // Histogram of the time between frames, with the 50th and 99th percentiles marked
+    int buckets[HUD_BUCKETS] = {};
+    int tallest = 1;
+    for(int i = 0; i < frames; i++)
+    {
+        int bucket = min((int)profile.frameHistory[i], HUD_BUCKETS - 1);
+        tallest = max(tallest, ++buckets[bucket]);
+    }
+    float graphLeft = HUD_LEFT + 2;
+    float graphBottom = bottom + 2;
+    glBegin(GL_QUADS);
+    for(int b = 0; b < HUD_BUCKETS; b++)
+    {
+        float height = buckets[b] * HUD_GRAPH_HEIGHT / tallest;
+        if(b >= TICK_BUDGET_MS)
+            rgb(255,0,0);           // Frames slower than a tick
+        else
+            rgb(0,255,0);
+        glVertex2f(graphLeft + b * HUD_BUCKET_WIDTH, graphBottom);
+        glVertex2f(graphLeft + (b + 1) * HUD_BUCKET_WIDTH - 1, graphBottom);
+        glVertex2f(graphLeft + (b + 1) * HUD_BUCKET_WIDTH - 1, graphBottom + height);
+        glVertex2f(graphLeft + b * HUD_BUCKET_WIDTH, graphBottom + height);
+    }
+    glEnd();
+    glBegin(GL_LINES);
+    rgb(255,255,0);
+    float percentiles[2] = {profilePercentile(profile.frameHistory, frames, 50),
+                            profilePercentile(profile.frameHistory, frames, 99)};
+    for(int i = 0; i < 2; i++)
+    {
+        float x = graphLeft + min(percentiles[i], (float)HUD_BUCKETS) * HUD_BUCKET_WIDTH;
+        glVertex2f(x, graphBottom);
+        glVertex2f(x, graphBottom + HUD_GRAPH_HEIGHT);
+    }
+    glEnd();
+
+    rgb(255,255,255);   // Reset drawing colour to white, preventing texture discolouration
 }
+#endif //PACMAN_PROFILE
 
 #endif //PACMAN_UI_H